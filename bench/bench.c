@@ -0,0 +1,315 @@
+#define NME_NO_MAIN
+#include "../src/nme.c"
+
+typedef struct sample sample_t;
+
+struct sample {
+    palette_t palettes[16];
+    uint32_t *colors;
+
+    size_t width;
+    size_t height;
+
+    uint8_t *indices;
+    uint8_t *pixels;
+
+    buffer_t rle;
+    wad_t wad;
+    image_t image;
+
+    arena_t arena;
+
+    buffer_t scanlines;
+    buffer_t encoded;
+
+    encoder_t const *encoder;
+};
+
+static double const BENCH_MINIMUM_DURATION = 0.25;
+
+static size_t const BENCH_IMAGE_WIDTH = 256;
+static size_t const BENCH_IMAGE_HEIGHT = 256;
+
+static uint64_t BENCH_RANDOM_STATE = 0x9E3779B97F4A7C15;
+
+static double get_seconds(void)
+{
+    return (double) get_time() * 1e-9;
+}
+
+static uint8_t get_random_byte(void)
+{
+    BENCH_RANDOM_STATE ^= BENCH_RANDOM_STATE << 13;
+    BENCH_RANDOM_STATE ^= BENCH_RANDOM_STATE >> 7;
+    BENCH_RANDOM_STATE ^= BENCH_RANDOM_STATE << 17;
+
+    return (uint8_t) (BENCH_RANDOM_STATE >> 56);
+}
+
+static void run_benchmark(char const *name, void (*function)(sample_t *),
+    sample_t *sample, double amount, char const *unit)
+{
+    size_t iterations = 0;
+
+    double start = get_seconds();
+    double elapsed = 0.0;
+
+    do {
+        function(sample);
+
+        ++iterations;
+        elapsed = get_seconds() - start;
+    } while (elapsed < BENCH_MINIMUM_DURATION);
+
+    printf("%-24s %12.2f %s\n", name, amount * (double) iterations / elapsed,
+        unit);
+}
+
+static void expand_sample_palettes(sample_t *sample)
+{
+    reset_arena(&sample->arena);
+    expand_palettes(&sample->arena, sample->palettes, 16);
+}
+
+static void convert_sample_to_rgb(sample_t *sample)
+{
+    for (size_t y = 0; y < sample->height; ++y) {
+        NME_CONVERT_ROW_TO_RGB(sample->pixels + 3 * sample->width * y,
+            sample->indices + (sample->width + 2) * y, sample->width,
+            sample->colors);
+    }
+}
+
+static void convert_sample_to_rgba(sample_t *sample)
+{
+    for (size_t y = 0; y < sample->height; ++y) {
+        NME_CONVERT_ROW_TO_RGBA(sample->pixels + 4 * sample->width * y,
+            sample->indices + (sample->width + 2) * y, sample->width,
+            sample->colors, 255);
+    }
+}
+
+static void decode_sample(sample_t *sample)
+{
+    if (decode_rle_image(sample->pixels, &sample->image) == NME_FALSE) {
+        die("corrupt benchmark image");
+    }
+}
+
+static void build_sample_paths(sample_t *sample)
+{
+    reset_arena(&sample->arena);
+
+    for (size_t i = 0; i < 1000; ++i) {
+        join_paths(&sample->arena, "output/directory0/directory1/directory2",
+            "archive0.wad", "image0001.rle", sizeof (".png"));
+    }
+}
+
+static void encode_sample(sample_t *sample)
+{
+    sample->encoded.size = 0;
+
+    if (sample->encoder->encode(&sample->encoded, &sample->scanlines,
+        sample->pixels, sample->width, sample->height, 4) == NME_FALSE) {
+        die("unable to encode benchmark image");
+    }
+}
+
+static void create_rle_sample(sample_t *sample)
+{
+    size_t const number_of_pixels = sample->width * sample->height;
+
+    for (size_t tracker = 0; tracker < number_of_pixels;) {
+        size_t count = 1 + get_random_byte() % 48;
+        size_t kind = get_random_byte() % 100;
+
+        if (count > number_of_pixels - tracker) {
+            count = number_of_pixels - tracker;
+        }
+
+        uint8_t header[2] = { 0xFF, (uint8_t) count };
+
+        if (kind < 35) {
+            append_to_buffer(&sample->rle, header, 2);
+        } else {
+            header[0] = 0xFE;
+
+            if (kind < 45) {
+                append_to_buffer(&sample->rle, header, 2);
+            } else {
+                append_to_buffer(&sample->rle, &header[1], 1);
+            }
+
+            append_to_buffer(&sample->rle, sample->indices + tracker, count);
+        }
+
+        tracker += count;
+    }
+
+    sample->wad.colors = sample->colors;
+    sample->wad.number_of_palettes = 16;
+
+    sample->image.parent = &sample->wad;
+
+    sample->image.width = (uint32_t) sample->width;
+    sample->image.height = (uint32_t) sample->height;
+
+    sample->image.pixel_data = sample->rle.data;
+    sample->image.pixel_data_size = sample->rle.size;
+}
+
+static void run_microbenchmarks(void)
+{
+    sample_t *sample = allocate(sizeof (sample_t));
+
+    sample->width = BENCH_IMAGE_WIDTH;
+    sample->height = BENCH_IMAGE_HEIGHT;
+
+    for (size_t i = 0; i < 16; ++i) {
+        for (size_t j = 0; j < 256; ++j) {
+            sample->palettes[i].colors[j] = (uint16_t) (get_random_byte() |
+                get_random_byte() << 8);
+        }
+    }
+
+    size_t const number_of_pixels = sample->width * sample->height;
+    double const megapixels = (double) number_of_pixels / 1e6;
+
+    sample->indices = allocate((sample->width + 2) * sample->height);
+    sample->pixels = allocate(number_of_pixels * 4);
+
+    for (size_t i = 0; i < (sample->width + 2) * sample->height; ++i) {
+        sample->indices[i] = get_random_byte();
+    }
+
+    arena_t colors;
+    memset(&colors, 0x00, sizeof (arena_t));
+
+    sample->colors = expand_palettes(&colors, sample->palettes, 16);
+    create_rle_sample(sample);
+
+    printf("%ux%u sample image\n\n", (unsigned) sample->width,
+        (unsigned) sample->height);
+
+    run_benchmark("palette expansion", expand_sample_palettes, sample, 16.0,
+        "palettes/s");
+    run_benchmark("rgb conversion", convert_sample_to_rgb, sample,
+        megapixels, "Mpx/s");
+    run_benchmark("rgba conversion", convert_sample_to_rgba, sample,
+        megapixels, "Mpx/s");
+    run_benchmark("rle decode", decode_sample, sample, megapixels, "Mpx/s");
+    run_benchmark("path building", build_sample_paths, sample, 1000.0 / 1e6,
+        "Mpaths/s");
+
+    int const levels[3] = { 0, 1, -1 };
+    int const default_level = NME_PNG_COMPRESSION_LEVEL;
+
+    for (encoder_t const *encoder = NME_ENCODERS; encoder->name != NULL;
+        ++encoder) {
+        sample->encoder = encoder;
+
+        for (size_t i = 0; i < 3; ++i) {
+            char name[32];
+
+            if (encoder == NME_PNG_ENCODER) {
+                NME_PNG_COMPRESSION_LEVEL = levels[i];
+
+                snprintf(name, sizeof (name), "encode png (%s)",
+                    (levels[i] == 0) ? "level 0" : (levels[i] == 1) ?
+                    "level 1" : "stb");
+            } else if (i == 0) {
+                snprintf(name, sizeof (name), "encode %s", encoder->name);
+            } else {
+                break;
+            }
+
+            run_benchmark(name, encode_sample, sample,
+                (double) number_of_pixels * 4 / 1e6, "MB/s");
+        }
+    }
+
+    NME_PNG_COMPRESSION_LEVEL = default_level;
+
+    free_arena(&colors);
+    free_arena(&sample->arena);
+
+    free_buffer(&sample->rle);
+    free_buffer(&sample->scanlines);
+    free_buffer(&sample->encoded);
+
+    release(sample->indices);
+    release(sample->pixels);
+    release(sample);
+}
+
+static void run_end_to_end_benchmark(char const *filename,
+    size_t number_of_workers)
+{
+    archive_t archive;
+
+    memset(&archive, 0x00, sizeof (archive_t));
+    archive.filename = filename;
+
+    map_input_file(&archive);
+
+    index_t *index = build_index(&archive);
+    size_t number_of_images = index->header->number_of_images;
+    size_t size = archive.size;
+
+    free_index(index);
+    unmap_input_file(&archive);
+
+    char *output_path = allocate(strlen(filename) + 5);
+    strcat(strcpy(output_path, filename), ".out");
+
+    double best = 0.0;
+
+    for (size_t i = 0; i < 3; ++i) {
+        append_to_buffer(&NME_INPUT_FILENAMES, &filename,
+            sizeof (char const *));
+
+        NME_OUTPUT_PATH = output_path;
+        NME_NUMBER_OF_WORKERS = number_of_workers;
+
+        double start = get_seconds();
+        process_dir_archives();
+        double elapsed = get_seconds() - start;
+
+        if (i == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    NME_OUTPUT_PATH = NULL;
+    release(output_path);
+
+    char name[64];
+    snprintf(name, sizeof (name), "extract (-j %zu)", number_of_workers);
+
+    printf("%-24s %12.2f MB/s %12.2f images/s\n", name,
+        (double) size / 1e6 / best, (double) number_of_images / best);
+}
+
+int main(int count, char *arguments[])
+{
+    NME_EXECUTABLE_NAME = get_executable_name(*arguments);
+
+    select_row_converters();
+    create_encoder_tables();
+
+    run_microbenchmarks();
+
+    for (int i = 1; i < count; ++i) {
+        printf("\n%s\n\n", arguments[i]);
+
+        run_end_to_end_benchmark(arguments[i], 1);
+
+        if (get_number_of_processors() > 1) {
+            run_end_to_end_benchmark(arguments[i],
+                get_number_of_processors());
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,1683 @@
+#define NME_NO_MAIN
+#include "../src/nme.c"
+
+#include <sys/wait.h>
+#include <ftw.h>
+
+typedef struct output output_t;
+
+struct output {
+    char *path;
+    nme_entry_type_t type;
+};
+
+static unsigned const CHECK_TIMEOUT = 60;
+static size_t const CHECK_MAXIMUM_ARGUMENTS = 32;
+
+static char const *CHECK_EXECUTABLE = NULL;
+static char const *CHECK_ARCHIVE = NULL;
+static char const *CHECK_DIRECTORY = NULL;
+
+static nme_archive_t *CHECK_HANDLE = NULL;
+static buffer_t CHECK_OUTPUTS;
+
+static size_t CHECK_NUMBER_OF_OUTPUTS = 0;
+
+static size_t CHECK_FAILURES = 0;
+static size_t CHECK_EXPECTATIONS = 0;
+
+static int expect(int condition, char const *message, ...)
+{
+    ++CHECK_EXPECTATIONS;
+
+    if (condition == NME_FALSE) {
+        va_list arguments;
+        va_start(arguments, message);
+
+        printf("    failed: ");
+        vprintf(message, arguments);
+        printf("\n");
+
+        va_end(arguments);
+        ++CHECK_FAILURES;
+    }
+
+    return condition;
+}
+
+static char *format_string(char const *format, ...)
+{
+    va_list arguments;
+
+    va_start(arguments, format);
+    int length = vsnprintf(NULL, 0, format, arguments);
+    va_end(arguments);
+
+    char *string = allocate((size_t) length + 1);
+
+    va_start(arguments, format);
+    vsnprintf(string, (size_t) length + 1, format, arguments);
+    va_end(arguments);
+
+    return string;
+}
+
+static int read_file(char const *filename, buffer_t *contents)
+{
+    FILE *file = fopen(filename, "rb");
+    contents->size = 0;
+
+    if (file == NULL) {
+        return NME_FALSE;
+    }
+
+    uint8_t chunk[65536];
+    size_t count = 0;
+
+    while ((count = fread(chunk, 1, sizeof (chunk), file)) != 0) {
+        append_to_buffer(contents, chunk, count);
+    }
+
+    fclose(file);
+    return NME_TRUE;
+}
+
+static void write_file(char const *filename, void const *data, size_t size)
+{
+    FILE *file = fopen(filename, "wb");
+
+    if (file == NULL || (size != 0 && fwrite(data, size, 1, file) != 1) ||
+        fclose(file) != 0) {
+        die("unable to write `%s`", filename);
+    }
+}
+
+static int remove_path(char const *path, struct stat const *status, int flag,
+    struct FTW *walk)
+{
+    (void) status;
+    (void) flag;
+    (void) walk;
+
+    return remove(path);
+}
+
+static void remove_tree(char const *path)
+{
+    nftw(path, remove_path, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+static pid_t start_executable(char const *argument, va_list list)
+{
+    char const *arguments[CHECK_MAXIMUM_ARGUMENTS];
+    size_t count = 0;
+
+    arguments[count++] = CHECK_EXECUTABLE;
+
+    for (; argument != NULL; argument = va_arg(list, char const *)) {
+        NME_ASSERT(count + 1 < CHECK_MAXIMUM_ARGUMENTS);
+        arguments[count++] = argument;
+    }
+
+    arguments[count] = NULL;
+
+    fflush(stdout);
+    pid_t process = fork();
+
+    if (process == 0) {
+        int output = open("/dev/null", O_WRONLY);
+
+        dup2(output, STDOUT_FILENO);
+        dup2(output, STDERR_FILENO);
+
+        alarm(CHECK_TIMEOUT);
+        execv(CHECK_EXECUTABLE, (char *const *) arguments);
+
+        _exit(127);
+    }
+
+    if (process < 0) {
+        die("unable to start `%s`", CHECK_EXECUTABLE);
+    }
+
+    return process;
+}
+
+static int wait_for_executable(pid_t process)
+{
+    int status = 0;
+
+    while (waitpid(process, &status, 0) < 0) {
+        if (errno != EINTR) {
+            die("unable to wait for `%s`", CHECK_EXECUTABLE);
+        }
+    }
+
+    return status;
+}
+
+static int run_executable(char const *argument, ...)
+{
+    va_list list;
+    va_start(list, argument);
+
+    pid_t process = start_executable(argument, list);
+    va_end(list);
+
+    return wait_for_executable(process);
+}
+
+static pid_t spawn_executable(char const *argument, ...)
+{
+    va_list list;
+    va_start(list, argument);
+
+    pid_t process = start_executable(argument, list);
+    va_end(list);
+
+    return process;
+}
+
+static int has_succeeded(int status)
+{
+    return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+static int has_failed_cleanly(int status)
+{
+    return WIFEXITED(status) && WEXITSTATUS(status) == EXIT_FAILURE;
+}
+
+static char const *describe_exit(int status)
+{
+    static char description[64];
+
+    if (WIFSIGNALED(status)) {
+        snprintf(description, sizeof (description), "killed by signal %d",
+            WTERMSIG(status));
+    } else {
+        snprintf(description, sizeof (description), "exited with %d",
+            WEXITSTATUS(status));
+    }
+
+    return description;
+}
+
+static int read_archive_output(nme_archive_t const *handle,
+    char const *path, buffer_t *contents)
+{
+    contents->size = 0;
+
+    if (has_extension(path, "rgba") == NME_FALSE ||
+        strstr(path, ".wad/") == NULL) {
+        size_t size = 0;
+
+        if (nme_read_entry(handle, path, NULL, 0, &size) ==
+            NME_ERROR_NOT_FOUND) {
+            return NME_FALSE;
+        }
+
+        uint8_t *data = append_to_buffer(contents, NULL, size);
+        return nme_read_entry(handle, path, data, size, &size) == NME_OK;
+    }
+
+    char const *extensions[2] = { "rle", "bmp" };
+    size_t const length = strlen(path) - strlen("rgba");
+
+    for (size_t i = 0; i < 2; ++i) {
+        char *image = format_string("%.*s%s", (int) length, path,
+            extensions[i]);
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+
+        nme_status_t status = nme_decode_image(handle, image, NULL, 0,
+            &width, &height);
+
+        if (status == NME_ERROR_BUFFER_TOO_SMALL) {
+            size_t const size = (size_t) width * height * 4;
+            uint8_t *pixels = append_to_buffer(contents, NULL, size);
+
+            status = nme_decode_image(handle, image, pixels, size, &width,
+                &height);
+        }
+
+        release(image);
+
+        if (status != NME_ERROR_NOT_FOUND) {
+            return status == NME_OK;
+        }
+    }
+
+    return NME_FALSE;
+}
+
+static void compare_output(char const *path, void const *data, size_t size)
+{
+    buffer_t expected;
+    memset(&expected, 0x00, sizeof (buffer_t));
+
+    int is_found = read_archive_output(CHECK_HANDLE, path, &expected);
+
+    expect(is_found == NME_TRUE && expected.size == size &&
+        (size == 0 || memcmp(expected.data, data, size) == 0),
+        "`%s` does not match the archive", path);
+
+    free_buffer(&expected);
+}
+
+static size_t compare_tree(char const *root, char const *prefix)
+{
+    char *path = (*prefix != '\0') ? format_string("%s/%s", root, prefix) :
+        format_string("%s", root);
+
+    DIR *directory = opendir(path);
+    size_t count = 0;
+
+    if (expect(directory != NULL, "unable to open `%s`", path) == NME_FALSE) {
+        release(path);
+        return 0;
+    }
+
+    buffer_t contents;
+    memset(&contents, 0x00, sizeof (buffer_t));
+
+    for (struct dirent *item; (item = readdir(directory)) != NULL;) {
+        if (strcmp(item->d_name, ".") == 0 ||
+            strcmp(item->d_name, "..") == 0 ||
+            strcmp(item->d_name, NME_MANIFEST_NAME) == 0) {
+            continue;
+        }
+
+        char *relative = (*prefix != '\0') ?
+            format_string("%s/%s", prefix, item->d_name) :
+            format_string("%s", item->d_name);
+        char *filename = format_string("%s/%s", root, relative);
+
+        struct stat information;
+
+        if (stat(filename, &information) == 0 &&
+            S_ISDIR(information.st_mode)) {
+            count += compare_tree(root, relative);
+        } else {
+            read_file(filename, &contents);
+            compare_output(relative, contents.data, contents.size);
+
+            ++count;
+        }
+
+        release(filename);
+        release(relative);
+    }
+
+    closedir(directory);
+    free_buffer(&contents);
+    release(path);
+
+    return count;
+}
+
+static int collect_output(nme_entry_t const *entry, void *context)
+{
+    (void) context;
+
+    if (entry->type == NME_ENTRY_FILE &&
+        has_extension(entry->path, "wad") == NME_TRUE) {
+        return 0;
+    }
+
+    output_t output = { format_string("%s", entry->path), entry->type };
+    append_to_buffer(&CHECK_OUTPUTS, &output, sizeof (output_t));
+
+    CHECK_NUMBER_OF_OUTPUTS += (entry->type != NME_ENTRY_DIRECTORY);
+    return 0;
+}
+
+static size_t read_statistic(char const *filename, char const *name)
+{
+    buffer_t contents;
+    memset(&contents, 0x00, sizeof (buffer_t));
+
+    read_file(filename, &contents);
+    append_to_buffer(&contents, "", 1);
+
+    char *key = format_string("\"%s\": ", name);
+    char const *value = strstr((char const *) contents.data, key);
+
+    size_t result = (value != NULL) ?
+        (size_t) strtoull(value + strlen(key), NULL, 10) : SIZE_MAX;
+
+    release(key);
+    free_buffer(&contents);
+
+    return result;
+}
+
+static void check_extraction(void)
+{
+    printf("extraction\n");
+
+    char *output = format_string("%s/extract", CHECK_DIRECTORY);
+    char *option = format_string("-e%s", output);
+
+    remove_tree(output);
+    int status = run_executable(option, "--format=rgba", CHECK_ARCHIVE, NULL);
+
+    if (expect(has_succeeded(status), "extraction %s",
+        describe_exit(status)) == NME_TRUE) {
+        size_t count = compare_tree(output, "");
+
+        expect(count == CHECK_NUMBER_OF_OUTPUTS,
+            "extracted %zu of %zu outputs", count, CHECK_NUMBER_OF_OUTPUTS);
+    }
+
+    remove_tree(output);
+
+    release(option);
+    release(output);
+}
+
+static void check_blocked_output(char const *backend, char const *output,
+    char const *option)
+{
+    char *statistics = format_string("%s/statistics.json", CHECK_DIRECTORY);
+    char *stats_option = format_string("--stats=%s", statistics);
+
+    output_t const *outputs = (output_t const *) CHECK_OUTPUTS.data;
+    size_t k = 0;
+
+    while (outputs[k].type != NME_ENTRY_FILE) {
+        ++k;
+    }
+
+    char *filename = format_string("%s/%s", output, outputs[k].path);
+
+    remove(filename);
+    mkdir(filename, 0777);
+
+    int status = run_executable(option, "--format=rgba", backend,
+        stats_option, CHECK_ARCHIVE, NULL);
+
+    if (expect(has_succeeded(status), "%s with a blocked output %s",
+        backend, describe_exit(status)) == NME_TRUE) {
+        size_t skipped = read_statistic(statistics, "files_skipped");
+        size_t written = read_statistic(statistics, "files_written");
+
+        expect(skipped == 1 && written == CHECK_NUMBER_OF_OUTPUTS - 1,
+            "%s skipped %zu and wrote %zu outputs around a blocked one",
+            backend, skipped, written);
+    }
+
+    rmdir(filename);
+    remove(statistics);
+
+    release(filename);
+    release(stats_option);
+    release(statistics);
+}
+
+static void check_async_io(void)
+{
+    printf("asynchronous writes\n");
+
+    char const *backends[2] = { "--async-io", "--async-io=threads" };
+
+    for (size_t i = 0; i < 2; ++i) {
+        char *output = format_string("%s/async%zu", CHECK_DIRECTORY, i);
+        char *option = format_string("-e%s", output);
+
+        remove_tree(output);
+        int status = run_executable(option, "--format=rgba", backends[i],
+            CHECK_ARCHIVE, NULL);
+
+        if (expect(has_succeeded(status), "%s %s", backends[i],
+            describe_exit(status)) == NME_TRUE) {
+            size_t count = compare_tree(output, "");
+
+            expect(count == CHECK_NUMBER_OF_OUTPUTS,
+                "%s wrote %zu of %zu outputs", backends[i], count,
+                CHECK_NUMBER_OF_OUTPUTS);
+
+            check_blocked_output(backends[i], output, option);
+        }
+
+        remove_tree(output);
+
+        release(option);
+        release(output);
+    }
+}
+
+static void check_globs(void)
+{
+    printf("glob matching\n");
+
+    struct {
+        char const *pattern;
+        char const *path;
+
+        int is_directory;
+        int is_match;
+    } const cases[] = {
+        { "directory0/*.bin", "directory0/file0.bin", NME_FALSE, NME_TRUE },
+        { "directory0/*.bin", "directory1/file0.bin", NME_FALSE, NME_FALSE },
+        { "directory0/*.bin", "directory0/a/file0.bin", NME_FALSE,
+            NME_FALSE },
+        { "**/*.wad", "archive0.wad", NME_FALSE, NME_TRUE },
+        { "**/*.wad", "a/b/archive0.wad", NME_FALSE, NME_TRUE },
+        { "**/image000?.*", "a/archive0.wad/image0003.rle", NME_FALSE,
+            NME_TRUE },
+        { "**/image000?.*", "a/archive0.wad/image0013.rle", NME_FALSE,
+            NME_FALSE },
+        { "*.WAD", "archive0.wad", NME_FALSE, NME_TRUE },
+        { "file?.bin", "file10.bin", NME_FALSE, NME_FALSE },
+        { "f*e*.bin", "file10.bin", NME_FALSE, NME_TRUE },
+        { "directory0", "directory0/directory1/file0.bin", NME_FALSE,
+            NME_TRUE },
+        { "directory0/directory1", "directory0", NME_TRUE, NME_TRUE },
+        { "directory0/directory1", "directory0", NME_FALSE, NME_FALSE },
+        { "directory0/directory1", "directory1", NME_TRUE, NME_FALSE },
+        { "a/**", "a/b/c", NME_FALSE, NME_TRUE },
+        { "a/**/c", "a/c", NME_FALSE, NME_TRUE },
+        { "a/**/c", "b/c", NME_FALSE, NME_FALSE },
+        { "**", "anything", NME_TRUE, NME_TRUE }
+    };
+
+    for (size_t i = 0; i < sizeof (cases) / sizeof (cases[0]); ++i) {
+        expect(match_glob(cases[i].pattern, cases[i].path,
+            cases[i].is_directory) == cases[i].is_match,
+            "`%s` %s `%s`", cases[i].pattern, (cases[i].is_match ==
+            NME_TRUE) ? "should match" : "should not match", cases[i].path);
+    }
+
+    char *output = format_string("%s/only", CHECK_DIRECTORY);
+    char *option = format_string("-e%s", output);
+
+    remove_tree(output);
+    int status = run_executable(option, "--only", "**/file0.bin",
+        CHECK_ARCHIVE, NULL);
+
+    if (expect(has_succeeded(status), "--only %s",
+        describe_exit(status)) == NME_TRUE) {
+        size_t count = compare_tree(output, "");
+        size_t expected = 0;
+
+        output_t const *outputs = (output_t const *) CHECK_OUTPUTS.data;
+
+        for (size_t i = 0; i < CHECK_OUTPUTS.size / sizeof (output_t); ++i) {
+            char const *name = strrchr(outputs[i].path, '/');
+            name = (name != NULL) ? name + 1 : outputs[i].path;
+
+            expected += (strcmp(name, "file0.bin") == 0);
+        }
+
+        expect(count == expected && expected != 0,
+            "--only extracted %zu files instead of %zu", count, expected);
+    }
+
+    remove_tree(output);
+
+    release(option);
+    release(output);
+}
+
+static void check_index(void)
+{
+    printf("index round trip\n");
+
+    archive_t archive;
+    memset(&archive, 0x00, sizeof (archive_t));
+
+    archive.filename = CHECK_ARCHIVE;
+    map_input_file(&archive);
+
+    char *filename = format_string("%s/check.idx", CHECK_DIRECTORY);
+    index_t *built = build_index(&archive);
+
+    dump_to_file(filename, built->data, built->size);
+    index_t *loaded = load_index(&archive, filename);
+
+    expect(loaded != NULL && loaded->size == built->size &&
+        memcmp(loaded->data, built->data, built->size) == 0,
+        "the index does not load back as written");
+
+    output_t const *outputs = (output_t const *) CHECK_OUTPUTS.data;
+
+    for (size_t i = 0; loaded != NULL &&
+        i < CHECK_OUTPUTS.size / sizeof (output_t); ++i) {
+        lookup_t lookup;
+        memset(&lookup, 0x00, sizeof (lookup_t));
+
+        nme_entry_t entry;
+        nme_find_entry(CHECK_HANDLE, outputs[i].path, &entry);
+
+        if (expect(resolve_in_index(&archive, loaded, outputs[i].path,
+            &lookup) == NME_TRUE, "`%s` is missing from the index",
+            outputs[i].path) == NME_FALSE) {
+            continue;
+        }
+
+        if (outputs[i].type == NME_ENTRY_IMAGE) {
+            expect(lookup.is_image == NME_TRUE &&
+                lookup.image.width == entry.width &&
+                lookup.image.height == entry.height,
+                "the index describes `%s` wrongly", outputs[i].path);
+        } else {
+            expect(lookup.is_image == NME_FALSE &&
+                lookup.entry.size == entry.size,
+                "the index describes `%s` wrongly", outputs[i].path);
+        }
+    }
+
+    lookup_t lookup;
+    memset(&lookup, 0x00, sizeof (lookup_t));
+
+    expect(loaded == NULL || resolve_in_index(&archive, loaded,
+        "missing/entry", &lookup) == NME_FALSE,
+        "the index resolves a missing path");
+
+    free_index(loaded);
+    free_index(built);
+
+    unmap_input_file(&archive);
+    remove(filename);
+
+    release(filename);
+}
+
+static void check_incremental(void)
+{
+    printf("incremental extraction\n");
+
+    char *output = format_string("%s/incremental", CHECK_DIRECTORY);
+    char *option = format_string("-e%s", output);
+
+    char *statistics = format_string("%s/statistics.json", CHECK_DIRECTORY);
+    char *stats_option = format_string("--stats=%s", statistics);
+
+    remove_tree(output);
+
+    size_t const expected[3] = { CHECK_NUMBER_OF_OUTPUTS, 0, 1 };
+
+    for (size_t i = 0; i < 3; ++i) {
+        if (i == 2) {
+            output_t const *outputs = (output_t const *) CHECK_OUTPUTS.data;
+            size_t k = 0;
+
+            while (outputs[k].type != NME_ENTRY_FILE) {
+                ++k;
+            }
+
+            char *filename = format_string("%s/%s", output, outputs[k].path);
+            remove(filename);
+            release(filename);
+        }
+
+        int status = run_executable(option, "--incremental", "--format=rgba",
+            stats_option, CHECK_ARCHIVE, NULL);
+
+        if (expect(has_succeeded(status), "run %zu %s", i + 1,
+            describe_exit(status)) == NME_FALSE) {
+            break;
+        }
+
+        size_t written = read_statistic(statistics, "files_written");
+
+        expect(written == expected[i],
+            "run %zu wrote %zu outputs instead of %zu", i + 1, written,
+            expected[i]);
+    }
+
+    size_t count = compare_tree(output, "");
+
+    expect(count == CHECK_NUMBER_OF_OUTPUTS,
+        "the incremental tree has %zu of %zu outputs", count,
+        CHECK_NUMBER_OF_OUTPUTS);
+
+    remove_tree(output);
+    remove(statistics);
+
+    release(stats_option);
+    release(statistics);
+    release(option);
+    release(output);
+}
+
+static size_t read_octal(uint8_t const *field, size_t size)
+{
+    char digits[16];
+
+    memcpy(digits, field, size);
+    digits[size] = '\0';
+
+    return (size_t) strtoull(digits, NULL, 8);
+}
+
+static void check_tar(void)
+{
+    printf("tar output\n");
+
+    char *filename = format_string("%s/check.tar", CHECK_DIRECTORY);
+    char *option = format_string("--output-tar=%s", filename);
+
+    int status = run_executable("-eroot", "--format=rgba", option,
+        CHECK_ARCHIVE, NULL);
+
+    buffer_t tar;
+    memset(&tar, 0x00, sizeof (buffer_t));
+
+    if (expect(has_succeeded(status), "--output-tar %s",
+        describe_exit(status)) == NME_FALSE || expect(read_file(filename,
+        &tar) == NME_TRUE && tar.size % 512 == 0 && tar.size >= 1024,
+        "`%s` is not a tar archive", filename) == NME_FALSE) {
+        free_buffer(&tar);
+
+        release(option);
+        release(filename);
+
+        return;
+    }
+
+    char *long_path = NULL;
+    size_t count = 0;
+
+    for (size_t offset = 0; offset + 512 <= tar.size;) {
+        uint8_t const *header = tar.data + offset;
+        size_t sum = 0;
+
+        for (size_t i = 0; i < 512; ++i) {
+            sum += (i >= 148 && i < 156) ? ' ' : header[i];
+        }
+
+        if (sum == 8 * ' ') {
+            expect(offset + 1024 == tar.size,
+                "the end of archive is not two zero blocks");
+            break;
+        }
+
+        expect(read_octal(header + 148, 8) == sum,
+            "bad header checksum at offset %zu", offset);
+        expect(memcmp(header + 257, "ustar\0" "00", 8) == 0,
+            "bad ustar magic at offset %zu", offset);
+
+        size_t const size = read_octal(header + 124, 12);
+        uint8_t const *data = header + 512;
+
+        offset += 512 + ((size + 511) & ~(size_t) 511);
+
+        if (expect(offset <= tar.size, "truncated member") == NME_FALSE) {
+            break;
+        }
+
+        if (header[156] == 'x') {
+            char const *record = memchr(data, ' ', size);
+            char const *end = (char const *) data + size - 1;
+
+            if (expect(record != NULL && strncmp(record, " path=", 6) == 0 &&
+                *end == '\n', "bad pax header") == NME_TRUE) {
+                long_path = format_string("%.*s", (int) (end - record - 6),
+                    record + 6);
+            }
+
+            continue;
+        }
+
+        char *path = long_path;
+
+        if (path == NULL && header[345] != '\0') {
+            path = format_string("%.155s/%.100s", (char const *) header + 345,
+                (char const *) header);
+        } else if (path == NULL) {
+            path = format_string("%.100s", (char const *) header);
+        }
+
+        long_path = NULL;
+
+        if (expect(header[156] == '0' && strncmp(path, "root/", 5) == 0,
+            "unexpected member `%s`", path) == NME_TRUE) {
+            compare_output(path + 5, data, size);
+            ++count;
+        }
+
+        release(path);
+    }
+
+    expect(count == CHECK_NUMBER_OF_OUTPUTS, "the tar has %zu of %zu outputs",
+        count, CHECK_NUMBER_OF_OUTPUTS);
+
+    release(long_path);
+    free_buffer(&tar);
+    remove(filename);
+
+    release(option);
+    release(filename);
+}
+
+static int send_request(FILE *requests, FILE *responses, char const *request,
+    char *header, size_t capacity, buffer_t *body)
+{
+    body->size = 0;
+
+    if (fprintf(requests, "%s\n", request) < 0 || fflush(requests) != 0 ||
+        fgets(header, (int) capacity, responses) == NULL) {
+        return NME_FALSE;
+    }
+
+    unsigned long long size = 0;
+
+    if (sscanf(header, "ok %llu", &size) == 1) {
+        uint8_t *data = append_to_buffer(body, NULL, (size_t) size);
+        return size == 0 || fread(data, (size_t) size, 1, responses) == 1;
+    }
+
+    return NME_TRUE;
+}
+
+static int connect_to_server(char const *filename)
+{
+    struct sockaddr_un address;
+    memset(&address, 0x00, sizeof (struct sockaddr_un));
+
+    address.sun_family = AF_UNIX;
+    snprintf(address.sun_path, sizeof (address.sun_path), "%s", filename);
+
+    for (size_t attempt = 0; attempt < 200; ++attempt) {
+        int descriptor = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (descriptor >= 0 && connect(descriptor, (struct sockaddr *)
+            &address, sizeof (struct sockaddr_un)) == 0) {
+            return descriptor;
+        }
+
+        if (descriptor >= 0) {
+            close(descriptor);
+        }
+
+        usleep(50000);
+    }
+
+    return -1;
+}
+
+static void check_server(void)
+{
+    printf("server protocol\n");
+
+    char *filename = format_string("%s/check.sock", CHECK_DIRECTORY);
+    pid_t server = spawn_executable("--serve", filename, CHECK_ARCHIVE,
+        NULL);
+
+    int descriptor = connect_to_server(filename);
+
+    if (expect(descriptor >= 0, "unable to connect to the server") ==
+        NME_FALSE) {
+        kill(server, SIGTERM);
+        wait_for_executable(server);
+
+        release(filename);
+        return;
+    }
+
+    FILE *requests = fdopen(dup(descriptor), "w");
+    FILE *responses = fdopen(descriptor, "r");
+
+    char header[256];
+
+    buffer_t body;
+    memset(&body, 0x00, sizeof (buffer_t));
+
+    output_t const *outputs = (output_t const *) CHECK_OUTPUTS.data;
+
+    for (size_t i = 0; i < CHECK_OUTPUTS.size / sizeof (output_t); ++i) {
+        if (outputs[i].type == NME_ENTRY_DIRECTORY) {
+            continue;
+        }
+
+        int const is_image = (outputs[i].type == NME_ENTRY_IMAGE);
+        char *request = format_string("%s %s %s", (is_image == NME_TRUE) ?
+            "rgba" : "file", CHECK_ARCHIVE, outputs[i].path);
+
+        if (expect(send_request(requests, responses, request, header,
+            sizeof (header), &body) == NME_TRUE && strncmp(header, "ok ", 3)
+            == 0, "`%s` failed", request) == NME_TRUE) {
+            char *path = (is_image == NME_TRUE) ? format_string("%.*srgba",
+                (int) (strlen(outputs[i].path) - 3), outputs[i].path) :
+                format_string("%s", outputs[i].path);
+
+            compare_output(path, body.data, body.size);
+            release(path);
+        }
+
+        release(request);
+    }
+
+    struct {
+        char const *request;
+        char const *response;
+    } const errors[] = {
+        { "file %s missing/entry", "error " },
+        { "zzz %s archive0.wad", "error unknown command" },
+        { "file other.dir file0.bin", "error unknown archive" },
+        { "nonsense", "error malformed request" },
+        { "stats", "ok " }
+    };
+
+    for (size_t i = 0; i < sizeof (errors) / sizeof (errors[0]); ++i) {
+        char *request = format_string(errors[i].request, CHECK_ARCHIVE);
+
+        expect(send_request(requests, responses, request, header,
+            sizeof (header), &body) == NME_TRUE &&
+            strncmp(header, errors[i].response,
+            strlen(errors[i].response)) == 0,
+            "`%s` answered `%s`", request, header);
+
+        release(request);
+    }
+
+    char *request = allocate(NME_MAXIMUM_REQUEST_LENGTH + 2);
+    memset(request, 'x', NME_MAXIMUM_REQUEST_LENGTH + 1);
+
+    expect(send_request(requests, responses, request, header,
+        sizeof (header), &body) == NME_TRUE &&
+        strcmp(header, "error request too long\n") == 0,
+        "an overlong request answered `%s`", header);
+
+    release(request);
+
+    fclose(requests);
+    fclose(responses);
+
+    kill(server, SIGTERM);
+    wait_for_executable(server);
+
+    remove(filename);
+
+    free_buffer(&body);
+    release(filename);
+}
+
+static void create_test_wad(wad_t *wad, palette_t *palette, arena_t *arena)
+{
+    memset(palette, 0x00, sizeof (palette_t));
+
+    for (size_t i = 0; i < 256; ++i) {
+        palette->colors[i] = (uint16_t) (i * 257);
+    }
+
+    memset(arena, 0x00, sizeof (arena_t));
+    memset(wad, 0x00, sizeof (wad_t));
+
+    wad->number_of_palettes = 1;
+    wad->palettes = palette;
+    wad->colors = expand_palettes(arena, palette, 1);
+}
+
+static void check_rle_bounds(void)
+{
+    printf("rle bounds\n");
+
+    wad_t wad;
+    palette_t palette;
+    arena_t arena;
+
+    create_test_wad(&wad, &palette, &arena);
+
+    struct {
+        uint8_t stream[16];
+        size_t size;
+
+        int is_valid;
+        size_t number_of_opaque;
+    } const cases[] = {
+        { { 8, 1, 2, 3, 4, 5, 6, 7, 8 }, 9, NME_TRUE, 8 },
+        { { 0xFE, 8, 1, 2, 3, 4, 5, 6, 7, 8 }, 10, NME_TRUE, 0 },
+        { { 0xFF, 2, 3, 1, 2, 3 }, 6, NME_TRUE, 3 },
+        { { 0 }, 0, NME_TRUE, 0 },
+        { { 9, 1, 2, 3, 4, 5, 6, 7, 8, 9 }, 10, NME_FALSE, 0 },
+        { { 0xFF, 9 }, 2, NME_FALSE, 0 },
+        { { 0xFF, 4, 0xFF, 5 }, 4, NME_FALSE, 0 },
+        { { 0xFE }, 1, NME_FALSE, 0 },
+        { { 4, 1, 2 }, 3, NME_FALSE, 0 },
+        { { 0xFE, 3, 1 }, 3, NME_FALSE, 0 }
+    };
+
+    uint8_t pixels[8 * 4];
+
+    for (size_t i = 0; i < sizeof (cases) / sizeof (cases[0]); ++i) {
+        image_t image;
+        memset(&image, 0x00, sizeof (image_t));
+
+        image.width = 4;
+        image.height = 2;
+        image.parent = &wad;
+
+        image.pixel_data = cases[i].stream;
+        image.pixel_data_size = cases[i].size;
+
+        memset(pixels, 0xCD, sizeof (pixels));
+        int is_valid = decode_rle_image(pixels, &image);
+
+        if (expect(is_valid == cases[i].is_valid, "rle case %zu was %s", i,
+            (is_valid == NME_TRUE) ? "accepted" : "rejected") == NME_FALSE ||
+            is_valid == NME_FALSE) {
+            continue;
+        }
+
+        size_t number_of_opaque = 0;
+
+        for (size_t k = 0; k < 8; ++k) {
+            number_of_opaque += (pixels[4 * k + 3] == 255);
+        }
+
+        expect(number_of_opaque == cases[i].number_of_opaque &&
+            pixels[sizeof (pixels) - 1] != 0xCD,
+            "rle case %zu decoded %zu opaque pixels", i, number_of_opaque);
+    }
+
+    image_t image;
+    memset(&image, 0x00, sizeof (image_t));
+
+    image.width = NME_MAXIMUM_RLE_SIZE + 1;
+    image.height = 1;
+
+    expect(has_rle_dimensions(&image) == NME_FALSE,
+        "an oversized rle image was accepted");
+
+    free_arena(&arena);
+}
+
+static void check_line_offsets(void)
+{
+    printf("rle line offsets\n");
+
+    wad_t wad;
+    palette_t palette;
+    arena_t arena;
+
+    create_test_wad(&wad, &palette, &arena);
+
+    size_t const width = 300;
+    size_t const height = 6;
+
+    uint8_t *pixels = allocate(width * height * 4);
+    uint8_t *indices = allocate(width * height);
+
+    uint8_t const alphas[3] = { 0, 127, 255 };
+
+    for (size_t i = 0; i < width * (height - 2); ++i) {
+        indices[i] = (uint8_t) (i * 7);
+        pixels[4 * i + 3] = alphas[(i / 5 + i / 300) % 3];
+    }
+
+    uint32_t offsets[6];
+
+    buffer_t stream;
+    memset(&stream, 0x00, sizeof (buffer_t));
+
+    append_rle_pixel_data(&stream, pixels, indices, width, height, offsets);
+
+    image_t image;
+    memset(&image, 0x00, sizeof (image_t));
+
+    image.width = (uint32_t) width;
+    image.height = (uint32_t) height;
+    image.parent = &wad;
+
+    image.pixel_data = stream.data;
+    image.pixel_data_size = stream.size;
+
+    uint8_t *expected = allocate(width * height * 4);
+    uint8_t *row = allocate(width * 4);
+
+    expect(decode_rle_image(expected, &image) == NME_TRUE,
+        "the packed rle stream does not decode");
+
+    image.height = 1;
+
+    for (size_t y = 0; y < height; ++y) {
+        size_t const end = (y + 1 < height) ? offsets[y + 1] : stream.size;
+
+        image.pixel_data = stream.data + offsets[y];
+        image.pixel_data_size = end - offsets[y];
+
+        expect(offsets[y] <= end && decode_rle_image(row, &image) ==
+            NME_TRUE && memcmp(row, expected + width * 4 * y, width * 4) == 0,
+            "line offset %zu does not start row %zu", (size_t) offsets[y], y);
+    }
+
+    free_buffer(&stream);
+
+    release(row);
+    release(expected);
+    release(indices);
+    release(pixels);
+
+    free_arena(&arena);
+}
+
+static uint32_t read_big_endian(uint8_t const *source)
+{
+    return (uint32_t) source[0] << 24 | (uint32_t) source[1] << 16 |
+        (uint32_t) source[2] << 8 | source[3];
+}
+
+static int decode_qoi(uint8_t const *data, size_t size, uint8_t *pixels,
+    size_t width, size_t height)
+{
+    if (size < 22 || memcmp(data, "qoif", 4) != 0 ||
+        read_big_endian(data + 4) != width ||
+        read_big_endian(data + 8) != height) {
+        return NME_FALSE;
+    }
+
+    uint8_t const *cursor = data + 14;
+    uint8_t const *end = data + size - 8;
+
+    uint8_t seen[64][4];
+    memset(seen, 0x00, sizeof (seen));
+
+    uint8_t pixel[4] = { 0, 0, 0, 255 };
+    size_t run = 0;
+
+    for (size_t i = 0; i < width * height; ++i, pixels += 4) {
+        if (run != 0) {
+            --run;
+        } else if (cursor >= end) {
+            return NME_FALSE;
+        } else if (*cursor == 0xFE || *cursor == 0xFF) {
+            size_t const count = (*cursor == 0xFF) ? 4 : 3;
+
+            if ((size_t) (end - cursor) <= count) {
+                return NME_FALSE;
+            }
+
+            memcpy(pixel, cursor + 1, count);
+            cursor += count + 1;
+        } else if ((*cursor & 0xC0) == 0x00) {
+            memcpy(pixel, seen[*(cursor++)], 4);
+        } else if ((*cursor & 0xC0) == 0x40) {
+            pixel[0] = (uint8_t) (pixel[0] + ((*cursor >> 4) & 3) - 2);
+            pixel[1] = (uint8_t) (pixel[1] + ((*cursor >> 2) & 3) - 2);
+            pixel[2] = (uint8_t) (pixel[2] + (*cursor & 3) - 2);
+            ++cursor;
+        } else if ((*cursor & 0xC0) == 0x80) {
+            if (end - cursor < 2) {
+                return NME_FALSE;
+            }
+
+            int const dg = (*cursor & 0x3F) - 32;
+
+            pixel[0] = (uint8_t) (pixel[0] + dg + (cursor[1] >> 4) - 8);
+            pixel[1] = (uint8_t) (pixel[1] + dg);
+            pixel[2] = (uint8_t) (pixel[2] + dg + (cursor[1] & 15) - 8);
+            cursor += 2;
+        } else {
+            run = *(cursor++) & 0x3F;
+        }
+
+        memcpy(seen[(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 +
+            pixel[3] * 11) % 64], pixel, 4);
+        memcpy(pixels, pixel, 4);
+    }
+
+    return (cursor == end && memcmp(end, "\0\0\0\0\0\0\0\1", 8) == 0);
+}
+
+static int decode_ppm(uint8_t const *data, size_t size, uint8_t *pixels,
+    size_t width, size_t height)
+{
+    char header[64];
+    int length = snprintf(header, sizeof (header), "P6\n%zu %zu\n255\n",
+        width, height);
+
+    if (size != (size_t) length + width * height * 3 ||
+        memcmp(data, header, (size_t) length) != 0) {
+        return NME_FALSE;
+    }
+
+    for (size_t i = 0; i < width * height; ++i) {
+        memcpy(pixels + 4 * i, data + length + 3 * i, 3);
+        pixels[4 * i + 3] = 255;
+    }
+
+    return NME_TRUE;
+}
+
+static int decode_encoded_image(char const *name, buffer_t const *encoded,
+    uint8_t *pixels, size_t width, size_t height)
+{
+    if (strcmp(name, "qoi") == 0) {
+        return decode_qoi(encoded->data, encoded->size, pixels, width,
+            height);
+    }
+
+    if (strcmp(name, "ppm") == 0) {
+        return decode_ppm(encoded->data, encoded->size, pixels, width,
+            height);
+    }
+
+    if (strcmp(name, "rgba") == 0) {
+        if (encoded->size != width * height * 4) {
+            return NME_FALSE;
+        }
+
+        memcpy(pixels, encoded->data, encoded->size);
+        return NME_TRUE;
+    }
+
+    int decoded_width = 0;
+    int decoded_height = 0;
+    int channels = 0;
+
+    uint8_t *decoded = stbi_load_from_memory(encoded->data,
+        (int) encoded->size, &decoded_width, &decoded_height, &channels, 4);
+
+    if (decoded == NULL) {
+        return NME_FALSE;
+    }
+
+    int is_valid = ((size_t) decoded_width == width &&
+        (size_t) decoded_height == height);
+
+    if (is_valid == NME_TRUE) {
+        memcpy(pixels, decoded, width * height * 4);
+    }
+
+    stbi_image_free(decoded);
+    return is_valid;
+}
+
+static void create_test_pixels(uint8_t *pixels, size_t width, size_t height,
+    size_t channels)
+{
+    uint32_t state = 0x2545F491;
+
+    for (size_t y = 0; y < height; ++y) {
+        for (size_t x = 0; x < width; ++x, pixels += channels) {
+            state = state * 1664525 + 1013904223;
+
+            uint8_t const noise = (uint8_t) (state >> 24);
+            size_t const band = (x / 16 + y / 8) % 4;
+
+            pixels[0] = (band == 0) ? 40 : (band == 1) ? (uint8_t) x : noise;
+            pixels[1] = (band == 3) ? (uint8_t) (x * 3) : (uint8_t) y;
+            pixels[2] = (band == 2) ? (uint8_t) (x ^ y) : (uint8_t) (x % 7);
+
+            if (channels == 4) {
+                pixels[3] = (band == 1) ? noise : (uint8_t) (255 - band);
+            }
+        }
+    }
+}
+
+static void check_encoded_pixels(char const *description,
+    encoder_t const *encoder, buffer_t const *encoded,
+    uint8_t const *expected, size_t width, size_t height)
+{
+    uint8_t *decoded = allocate(width * height * 4);
+
+    if (expect(decode_encoded_image(encoder->name, encoded, decoded, width,
+        height), "%s does not decode", description) == NME_TRUE) {
+        expect(memcmp(decoded, expected, width * height * 4) == 0,
+            "%s does not decode to the encoded pixels", description);
+    }
+
+    release(decoded);
+}
+
+static void check_direct_encoder(encoder_t const *encoder, buffer_t *encoded,
+    buffer_t *scratch, size_t width, size_t height, size_t channels)
+{
+    char description[128];
+    snprintf(description, sizeof (description), "%s (level %d, %zux%zu, "
+        "%zu channels)", encoder->name, NME_PNG_COMPRESSION_LEVEL, width,
+        height, channels);
+
+    uint8_t *pixels = allocate(width * height * channels);
+    uint8_t *expected = allocate(width * height * 4);
+
+    create_test_pixels(pixels, width, height, channels);
+
+    int const has_alpha = (channels == 4 && encoder->encode != encode_ppm);
+
+    for (size_t i = 0; i < width * height; ++i) {
+        memcpy(expected + 4 * i, pixels + channels * i, 3);
+        expected[4 * i + 3] = (has_alpha == NME_TRUE) ?
+            pixels[4 * i + 3] : 255;
+    }
+
+    encoded->size = 0;
+
+    if (expect(encoder->encode(encoded, scratch, pixels, width, height,
+        channels), "%s was not encoded", description) == NME_TRUE) {
+        check_encoded_pixels(description, encoder, encoded, expected, width,
+            height);
+    }
+
+    release(expected);
+    release(pixels);
+}
+
+static void check_indexed_encoder(encoder_t const *encoder,
+    buffer_t *encoded, buffer_t *scratch, size_t width, size_t height,
+    size_t number_of_alphas)
+{
+    char description[128];
+    snprintf(description, sizeof (description), "indexed %s (level %d, "
+        "%zux%zu, %zu alphas)", encoder->name, NME_PNG_COMPRESSION_LEVEL,
+        width, height, number_of_alphas);
+
+    indexed_image_t image;
+    memset(&image, 0x00, sizeof (indexed_image_t));
+
+    uint8_t *indices = allocate(width * height);
+    uint8_t *expected = allocate(width * height * 4);
+
+    image.indices = indices;
+    image.width = width;
+    image.height = height;
+    image.stride = width;
+    image.number_of_colors = 200;
+    image.number_of_alphas = number_of_alphas;
+
+    for (size_t i = 0; i < image.number_of_colors; ++i) {
+        image.palette[i][0] = (uint8_t) (i * 5);
+        image.palette[i][1] = (uint8_t) (255 - i);
+        image.palette[i][2] = (uint8_t) (i * 37);
+        image.palette[i][3] = (i < number_of_alphas) ? (uint8_t) (i * 9) :
+            255;
+    }
+
+    for (size_t i = 0; i < width * height; ++i) {
+        indices[i] = (uint8_t) ((i / 5 + i * (i % 3)) %
+            image.number_of_colors);
+        memcpy(expected + 4 * i, image.palette[indices[i]], 4);
+    }
+
+    encoded->size = 0;
+
+    int is_encoded = encoder->encode_indexed(encoded, scratch, &image);
+
+    if (number_of_alphas != 0 && encoder->encode_indexed ==
+        encode_indexed_bmp) {
+        expect(is_encoded == NME_FALSE,
+            "%s accepted a translucent palette", description);
+    } else if (expect(is_encoded, "%s was not encoded",
+        description) == NME_TRUE) {
+        check_encoded_pixels(description, encoder, encoded, expected, width,
+            height);
+    }
+
+    release(expected);
+    release(indices);
+}
+
+static void check_encoders(void)
+{
+    printf("encoders\n");
+
+    int const levels[4] = { -1, 0, 1, 9 };
+    size_t const sizes[3][2] = { { 1, 1 }, { 7, 3 }, { 160, 120 } };
+
+    buffer_t encoded, scratch;
+
+    memset(&encoded, 0x00, sizeof (buffer_t));
+    memset(&scratch, 0x00, sizeof (buffer_t));
+
+    for (size_t i = 0; i < sizeof (levels) / sizeof (levels[0]); ++i) {
+        NME_PNG_COMPRESSION_LEVEL = levels[i];
+        stbi_write_png_compression_level = (levels[i] > 1) ? levels[i] : 8;
+
+        for (encoder_t const *encoder = NME_ENCODERS; encoder->name != NULL;
+            ++encoder) {
+            if (levels[i] != -1 && encoder != NME_PNG_ENCODER) {
+                continue;
+            }
+
+            for (size_t k = 0; k < sizeof (sizes) / sizeof (sizes[0]); ++k) {
+                size_t const width = sizes[k][0];
+                size_t const height = sizes[k][1];
+
+                if (encoder->requires_alpha == NME_FALSE) {
+                    check_direct_encoder(encoder, &encoded, &scratch, width,
+                        height, 3);
+                }
+
+                check_direct_encoder(encoder, &encoded, &scratch, width,
+                    height, 4);
+
+                if (encoder->encode_indexed != NULL) {
+                    check_indexed_encoder(encoder, &encoded, &scratch, width,
+                        height, 0);
+                    check_indexed_encoder(encoder, &encoded, &scratch, width,
+                        height, 30);
+                }
+            }
+        }
+    }
+
+    NME_PNG_COMPRESSION_LEVEL = -1;
+    stbi_write_png_compression_level = 8;
+
+    free_buffer(&scratch);
+    free_buffer(&encoded);
+}
+
+static void check_pack_round_trip(void)
+{
+    printf("pack round trip\n");
+
+    char *first = format_string("%s/first", CHECK_DIRECTORY);
+    char *second = format_string("%s/second", CHECK_DIRECTORY);
+
+    char *first_archive = format_string("%s.dir", first);
+    char *second_archive = format_string("%s.dir", second);
+
+    char *first_option = format_string("-e%s", first);
+    char *second_option = format_string("-e%s", second);
+
+    int const statuses[4] = {
+        run_executable(first_option, CHECK_ARCHIVE, NULL),
+        run_executable("--pack", first, first_archive, NULL),
+        run_executable(second_option, first_archive, NULL),
+        run_executable("--pack", second, second_archive, NULL)
+    };
+
+    char const *steps[4] = {
+        "extracting", "packing", "extracting the packed archive",
+        "packing it again"
+    };
+
+    int is_complete = NME_TRUE;
+
+    for (size_t i = 0; i < 4 && is_complete == NME_TRUE; ++i) {
+        is_complete = expect(has_succeeded(statuses[i]), "%s %s", steps[i],
+            describe_exit(statuses[i]));
+    }
+
+    buffer_t first_contents, second_contents;
+
+    memset(&first_contents, 0x00, sizeof (buffer_t));
+    memset(&second_contents, 0x00, sizeof (buffer_t));
+
+    read_file(first_archive, &first_contents);
+    read_file(second_archive, &second_contents);
+
+    expect(is_complete == NME_FALSE || (first_contents.size != 0 &&
+        first_contents.size == second_contents.size &&
+        memcmp(first_contents.data, second_contents.data,
+        first_contents.size) == 0),
+        "packing an extracted archive is not byte for byte stable");
+
+    free_buffer(&second_contents);
+    free_buffer(&first_contents);
+
+    remove_tree(first);
+    remove_tree(second);
+
+    remove(first_archive);
+    remove(second_archive);
+
+    release(second_option);
+    release(first_option);
+    release(second_archive);
+    release(first_archive);
+    release(second);
+    release(first);
+}
+
+static void check_library(void)
+{
+    printf("library interface\n");
+
+    nme_archive_t *handle = NULL;
+    char *filename = format_string("%s/missing.dir", CHECK_DIRECTORY);
+
+    expect(nme_open(filename, &handle) == NME_ERROR_OPEN && handle == NULL,
+        "opening a missing archive did not fail");
+
+    buffer_t contents;
+    memset(&contents, 0x00, sizeof (buffer_t));
+
+    read_file(CHECK_ARCHIVE, &contents);
+
+    expect(nme_open_memory(contents.data, contents.size, &handle) == NME_OK,
+        "unable to open the archive from memory");
+
+    nme_entry_t entry;
+    output_t const *outputs = (output_t const *) CHECK_OUTPUTS.data;
+
+    buffer_t expected, actual;
+
+    memset(&expected, 0x00, sizeof (buffer_t));
+    memset(&actual, 0x00, sizeof (buffer_t));
+
+    for (size_t i = 0; handle != NULL &&
+        i < CHECK_OUTPUTS.size / sizeof (output_t); ++i) {
+        char const *path = outputs[i].path;
+
+        if (expect(nme_find_entry(handle, path, &entry) == NME_OK &&
+            (int) entry.type == (int) outputs[i].type, "unable to find `%s`",
+            path) == NME_FALSE || outputs[i].type != NME_ENTRY_FILE) {
+            continue;
+        }
+
+        read_archive_output(CHECK_HANDLE, path, &expected);
+        read_archive_output(handle, path, &actual);
+
+        expect(expected.size == actual.size && (actual.size == 0 ||
+            memcmp(expected.data, actual.data, actual.size) == 0),
+            "`%s` differs between nme_open and nme_open_memory", path);
+    }
+
+    size_t size = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    for (size_t i = 0; i < CHECK_OUTPUTS.size / sizeof (output_t); ++i) {
+        char const *path = outputs[i].path;
+
+        if (outputs[i].type == NME_ENTRY_DIRECTORY) {
+            expect(nme_read_entry(CHECK_HANDLE, path, NULL, 0, &size) ==
+                NME_ERROR_WRONG_TYPE, "reading directory `%s` did not fail",
+                path);
+        } else if (outputs[i].type == NME_ENTRY_IMAGE) {
+            uint8_t pixel[4];
+
+            expect(nme_decode_image(CHECK_HANDLE, path, pixel,
+                sizeof (pixel), &width, &height) ==
+                NME_ERROR_BUFFER_TOO_SMALL && width != 0 && height != 0,
+                "decoding `%s` into 4 bytes did not fail", path);
+        }
+    }
+
+    expect(nme_find_entry(CHECK_HANDLE, "missing/entry", &entry) ==
+        NME_ERROR_NOT_FOUND, "a missing entry was found");
+    expect(nme_open(NULL, &handle) == NME_ERROR_INVALID_ARGUMENT,
+        "a NULL filename was accepted");
+
+    nme_close(handle);
+
+    free_buffer(&actual);
+    free_buffer(&expected);
+    free_buffer(&contents);
+
+    release(filename);
+}
+
+static void check_corrupt_archive(char const *name, void const *data,
+    size_t size, int is_corrupt)
+{
+    char *filename = format_string("%s/corrupt.dir", CHECK_DIRECTORY);
+    char *output = format_string("%s/corrupt", CHECK_DIRECTORY);
+    char *option = format_string("-e%s", output);
+
+    write_file(filename, data, size);
+
+    int const statuses[3] = {
+        run_executable("-z", filename, NULL),
+        run_executable(option, "-j4", filename, NULL),
+        run_executable("--build-index", filename, NULL)
+    };
+
+    char const *modes[3] = { "-z", "-e", "--build-index" };
+
+    for (size_t i = 0; i < 3; ++i) {
+        int const is_clean = (is_corrupt == NME_TRUE) ?
+            has_failed_cleanly(statuses[i]) : WIFEXITED(statuses[i]);
+
+        expect(is_clean, "%s on %s %s", modes[i], name,
+            describe_exit(statuses[i]));
+    }
+
+    nme_archive_t *handle = NULL;
+    nme_status_t status = nme_open_memory(data, size, &handle);
+
+    expect(is_corrupt == NME_FALSE || status == NME_ERROR_CORRUPT,
+        "nme_open_memory on %s returned `%s`", name,
+        nme_describe_status(status));
+
+    nme_close(handle);
+
+    remove_tree(output);
+
+    char *index = format_string("%s.idx", filename);
+
+    remove(index);
+    remove(filename);
+
+    release(index);
+    release(option);
+    release(output);
+    release(filename);
+}
+
+static void write_test_entry(uint8_t *destination, char const *name,
+    int8_t type, uint32_t size, uint32_t offset)
+{
+    memset(destination, 0x00, offsetof (entry_t, parent));
+    strcpy((char *) destination, name);
+
+    destination[32] = (uint8_t) type;
+
+    memcpy(destination + 36, &size, sizeof (uint32_t));
+    memcpy(destination + 40, &offset, sizeof (uint32_t));
+}
+
+static void check_corrupt_archives(void)
+{
+    printf("corrupt archives\n");
+
+    size_t const entry_size = offsetof (entry_t, parent);
+    uint8_t cycle[4 * offsetof (entry_t, parent)];
+
+    write_test_entry(cycle, "loop", NME_DIRECTORY, 0, 0);
+    write_test_entry(cycle + entry_size, "", NME_END_OF_DIRECTORY, 0, 0);
+
+    check_corrupt_archive("a directory listing itself", cycle,
+        2 * entry_size, NME_TRUE);
+
+    write_test_entry(cycle, "a", NME_DIRECTORY, 0, 2 * entry_size);
+    write_test_entry(cycle + entry_size, "", NME_END_OF_DIRECTORY, 0, 0);
+    write_test_entry(cycle + 2 * entry_size, "b", NME_DIRECTORY, 0,
+        2 * entry_size);
+    write_test_entry(cycle + 3 * entry_size, "", NME_END_OF_DIRECTORY, 0, 0);
+
+    check_corrupt_archive("a directory listing its parent", cycle,
+        4 * entry_size, NME_TRUE);
+
+    buffer_t contents;
+    memset(&contents, 0x00, sizeof (buffer_t));
+
+    read_file(CHECK_ARCHIVE, &contents);
+
+    for (size_t i = 1; i < 32; ++i) {
+        size_t const size = contents.size * i / 32;
+        char *name = format_string("an archive cut at %zu bytes", size);
+
+        check_corrupt_archive(name, contents.data, size, NME_FALSE);
+        release(name);
+    }
+
+    uint64_t state = 0x9E3779B97F4A7C15;
+
+    for (size_t i = 0; i < 32; ++i) {
+        buffer_t corrupt;
+        memset(&corrupt, 0x00, sizeof (buffer_t));
+
+        append_to_buffer(&corrupt, contents.data, contents.size);
+
+        for (size_t k = 0; k < 16; ++k) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+
+            corrupt.data[(state >> 16) % corrupt.size] = (uint8_t) state;
+        }
+
+        char *name = format_string("corrupted archive %zu", i);
+
+        check_corrupt_archive(name, corrupt.data, corrupt.size, NME_FALSE);
+
+        release(name);
+        free_buffer(&corrupt);
+    }
+
+    free_buffer(&contents);
+}
+
+int main(int count, char *arguments[])
+{
+    NME_EXECUTABLE_NAME = get_executable_name(*arguments);
+
+    if (count != 4) {
+        fprintf(stderr, "usage: %s nme archive directory\n",
+            NME_EXECUTABLE_NAME);
+
+        return EXIT_FAILURE;
+    }
+
+    CHECK_EXECUTABLE = arguments[1];
+    CHECK_ARCHIVE = arguments[2];
+    CHECK_DIRECTORY = arguments[3];
+
+    select_row_converters();
+    create_encoder_tables();
+
+    nme_status_t status = nme_open(CHECK_ARCHIVE, &CHECK_HANDLE);
+
+    if (status != NME_OK) {
+        fail("unable to open `%s`: %s", CHECK_ARCHIVE,
+            nme_describe_status(status));
+    }
+
+    nme_for_each_entry(CHECK_HANDLE, collect_output, NULL);
+
+    check_extraction();
+    check_async_io();
+    check_globs();
+    check_index();
+    check_incremental();
+    check_tar();
+    check_server();
+    check_rle_bounds();
+    check_line_offsets();
+    check_encoders();
+    check_pack_round_trip();
+    check_library();
+    check_corrupt_archives();
+
+    output_t *outputs = (output_t *) CHECK_OUTPUTS.data;
+
+    for (size_t i = 0; i < CHECK_OUTPUTS.size / sizeof (output_t); ++i) {
+        release(outputs[i].path);
+    }
+
+    free_buffer(&CHECK_OUTPUTS);
+    nme_close(CHECK_HANDLE);
+
+    printf("\n%zu of %zu checks failed\n", CHECK_FAILURES,
+        CHECK_EXPECTATIONS);
+
+    return (CHECK_FAILURES == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
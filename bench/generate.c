@@ -0,0 +1,483 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include <string.h>
+
+#define GEN_TRUE 1
+#define GEN_FALSE 0
+
+#define GEN_FILE 0
+#define GEN_DIRECTORY 1
+#define GEN_END_OF_DIRECTORY -1
+
+typedef struct buffer buffer_t;
+typedef struct settings settings_t;
+typedef struct statistics statistics_t;
+
+struct buffer {
+    uint8_t *data;
+
+    size_t size;
+    size_t capacity;
+};
+
+struct settings {
+    char const *output_filename;
+
+    size_t depth;
+    size_t number_of_directories;
+    size_t number_of_files;
+    size_t number_of_wads;
+    size_t number_of_images;
+    size_t number_of_palettes;
+
+    size_t image_size;
+    size_t file_size;
+    size_t rle_percentage;
+
+    uint64_t seed;
+};
+
+struct statistics {
+    size_t number_of_directories;
+    size_t number_of_files;
+    size_t number_of_wads;
+    size_t number_of_images;
+    size_t number_of_rle_images;
+};
+
+static size_t const GEN_ENTRY_SIZE = 44;
+static size_t const GEN_PALETTE_SIZE = 525;
+
+static char const *GEN_EXECUTABLE_NAME = "nme-generate";
+
+static settings_t GEN_SETTINGS = {
+    NULL, 3, 3, 4, 2, 32, 4, 64, 4096, 50, 1
+};
+
+static statistics_t GEN_STATISTICS = { 0, 0, 0, 0, 0 };
+
+static uint64_t GEN_RANDOM_STATE = 1;
+
+static void fail(char const *message)
+{
+    fprintf(stderr, "%s: %s\n", GEN_EXECUTABLE_NAME, message);
+    exit(EXIT_FAILURE);
+}
+
+static uint32_t get_random_number(void)
+{
+    GEN_RANDOM_STATE ^= GEN_RANDOM_STATE << 13;
+    GEN_RANDOM_STATE ^= GEN_RANDOM_STATE >> 7;
+    GEN_RANDOM_STATE ^= GEN_RANDOM_STATE << 17;
+
+    return (uint32_t) (GEN_RANDOM_STATE >> 32);
+}
+
+static size_t get_random_number_between(size_t minimum, size_t maximum)
+{
+    if (maximum <= minimum) {
+        return minimum;
+    }
+
+    return minimum + get_random_number() % (maximum - minimum + 1);
+}
+
+static uint8_t *append_to_buffer(buffer_t *buffer, void const *data,
+    size_t size)
+{
+    if (buffer->size + size > UINT32_MAX) {
+        fail("archive exceeds 4 GiB");
+    }
+
+    if (buffer->size + size > buffer->capacity) {
+        size_t capacity = buffer->capacity * 2 + size + 4096;
+        uint8_t *expanded = realloc(buffer->data, capacity);
+
+        if (expanded == NULL) {
+            fail("out of memory");
+        }
+
+        buffer->data = expanded;
+        buffer->capacity = capacity;
+    }
+
+    uint8_t *destination = buffer->data + buffer->size;
+    buffer->size += size;
+
+    if (data != NULL) {
+        memcpy(destination, data, size);
+    } else {
+        memset(destination, 0x00, size);
+    }
+
+    return destination;
+}
+
+static void append_byte(buffer_t *buffer, uint8_t value)
+{
+    append_to_buffer(buffer, &value, 1);
+}
+
+static void append_uint16(buffer_t *buffer, uint16_t value)
+{
+    uint8_t const bytes[2] = { (uint8_t) value, (uint8_t) (value >> 8) };
+    append_to_buffer(buffer, bytes, sizeof (bytes));
+}
+
+static void append_uint32(buffer_t *buffer, uint32_t value)
+{
+    uint8_t const bytes[4] = {
+        (uint8_t) value, (uint8_t) (value >> 8), (uint8_t) (value >> 16),
+        (uint8_t) (value >> 24)
+    };
+
+    append_to_buffer(buffer, bytes, sizeof (bytes));
+}
+
+static void append_random_bytes(buffer_t *buffer, size_t size)
+{
+    uint8_t *destination = append_to_buffer(buffer, NULL, size);
+
+    for (size_t i = 0; i < size; ++i) {
+        destination[i] = (uint8_t) get_random_number();
+    }
+}
+
+static void copy_name(uint8_t *destination, char const *name)
+{
+    size_t length = strlen(name);
+    memcpy(destination, name, (length < 31) ? length : 31);
+}
+
+static void append_name(buffer_t *buffer, char const *name)
+{
+    copy_name(append_to_buffer(buffer, NULL, 32), name);
+}
+
+static void write_entry(uint8_t *destination, char const *name, int8_t type,
+    uint32_t size, uint32_t offset)
+{
+    memset(destination, 0x00, GEN_ENTRY_SIZE);
+    copy_name(destination, name);
+
+    destination[32] = (uint8_t) type;
+
+    for (size_t i = 0; i < 4; ++i) {
+        destination[36 + i] = (uint8_t) (size >> (8 * i));
+        destination[40 + i] = (uint8_t) (offset >> (8 * i));
+    }
+}
+
+static void append_rle_pixel_data(buffer_t *buffer, size_t width,
+    size_t height, uint32_t *offsets)
+{
+    size_t const start = buffer->size;
+
+    for (size_t tracker = 0; tracker < width * height;) {
+        size_t count = get_random_number_between(1, 48);
+        size_t kind = get_random_number() % 100;
+
+        if (tracker % width == 0) {
+            offsets[tracker / width] = (uint32_t) (buffer->size - start);
+        }
+
+        if (count > width - tracker % width) {
+            count = width - tracker % width;
+        }
+
+        if (kind < 35) {
+            append_byte(buffer, 0xFF);
+            append_byte(buffer, (uint8_t) count);
+        } else {
+            if (kind < 45) {
+                append_byte(buffer, 0xFE);
+            }
+
+            append_byte(buffer, (uint8_t) count);
+            append_random_bytes(buffer, count);
+        }
+
+        tracker += count;
+    }
+}
+
+static void append_image(buffer_t *buffer, size_t index, size_t palettes)
+{
+    size_t const maximum = GEN_SETTINGS.image_size;
+
+    size_t width = get_random_number_between(maximum / 2 + 1, maximum);
+    size_t height = get_random_number_between(maximum / 2 + 1, maximum);
+
+    int is_rle = (get_random_number() % 100 < GEN_SETTINGS.rle_percentage);
+
+    char name[32];
+    snprintf(name, sizeof (name), "image%04zu.%s", index,
+        (is_rle == GEN_TRUE) ? "rle" : "bmp");
+
+    append_name(buffer, name);
+
+    size_t size_offset = buffer->size;
+    append_to_buffer(buffer, NULL, 16);
+
+    append_uint32(buffer, (uint32_t) height);
+    append_uint32(buffer, (uint32_t) width);
+    append_uint16(buffer, 8);
+    append_to_buffer(buffer, NULL, 6);
+
+    size_t pixel_data_offset = buffer->size;
+    uint32_t *offsets = malloc(sizeof (uint32_t) * height);
+
+    if (offsets == NULL) {
+        fail("out of memory");
+    }
+
+    if (is_rle == GEN_TRUE) {
+        append_rle_pixel_data(buffer, width, height, offsets);
+    } else {
+        append_random_bytes(buffer, (width + 2) * height);
+    }
+
+    uint64_t pixel_data_size = buffer->size - pixel_data_offset;
+
+    for (size_t i = 0; i < 8; ++i) {
+        buffer->data[size_offset + i] = (uint8_t) (pixel_data_size >> (8 * i));
+    }
+
+    if (is_rle == GEN_TRUE) {
+        append_uint32(buffer, (uint32_t) (sizeof (uint32_t) * height));
+        append_to_buffer(buffer, NULL, 4);
+        append_uint32(buffer, (uint32_t) width);
+        append_uint32(buffer, (uint32_t) height);
+
+        for (size_t y = 0; y < height; ++y) {
+            append_uint32(buffer, offsets[y]);
+        }
+
+        ++GEN_STATISTICS.number_of_rle_images;
+    }
+
+    free(offsets);
+
+    append_uint32(buffer, (uint32_t) (get_random_number() % palettes));
+    ++GEN_STATISTICS.number_of_images;
+}
+
+static void append_wad(buffer_t *buffer)
+{
+    size_t palettes = GEN_SETTINGS.number_of_palettes;
+
+    append_to_buffer(buffer, NULL, 400);
+    append_uint32(buffer, (uint32_t) palettes);
+
+    for (size_t i = 0; i < palettes; ++i) {
+        append_random_bytes(buffer, 512);
+        append_to_buffer(buffer, NULL, GEN_PALETTE_SIZE - 512);
+    }
+
+    append_uint32(buffer, (uint32_t) GEN_SETTINGS.number_of_images);
+
+    for (size_t i = 0; i < GEN_SETTINGS.number_of_images; ++i) {
+        append_image(buffer, i, palettes);
+    }
+
+    ++GEN_STATISTICS.number_of_wads;
+}
+
+static void append_directory(buffer_t *buffer, size_t listing_offset,
+    size_t depth)
+{
+    size_t number_of_directories = (depth < GEN_SETTINGS.depth) ?
+        GEN_SETTINGS.number_of_directories : 0;
+
+    size_t number_of_entries = number_of_directories +
+        GEN_SETTINGS.number_of_files + GEN_SETTINGS.number_of_wads;
+
+    for (size_t i = 0; i < number_of_entries; ++i) {
+        char name[32];
+        int8_t type = GEN_FILE;
+
+        size_t offset = buffer->size;
+
+        if (i < number_of_directories) {
+            snprintf(name, sizeof (name), "directory%zu", i);
+            type = GEN_DIRECTORY;
+
+            append_to_buffer(buffer, NULL, GEN_ENTRY_SIZE *
+                (GEN_SETTINGS.number_of_directories * (depth + 1 <
+                GEN_SETTINGS.depth) + GEN_SETTINGS.number_of_files +
+                GEN_SETTINGS.number_of_wads + 1));
+
+            append_directory(buffer, offset, depth + 1);
+            ++GEN_STATISTICS.number_of_directories;
+        } else if (i < number_of_directories + GEN_SETTINGS.number_of_wads) {
+            snprintf(name, sizeof (name), "archive%zu.wad",
+                i - number_of_directories);
+
+            append_wad(buffer);
+        } else {
+            snprintf(name, sizeof (name), "file%zu.bin", i -
+                number_of_directories - GEN_SETTINGS.number_of_wads);
+
+            append_random_bytes(buffer, get_random_number_between(
+                GEN_SETTINGS.file_size / 2, GEN_SETTINGS.file_size));
+
+            ++GEN_STATISTICS.number_of_files;
+        }
+
+        size_t size = (type == GEN_FILE) ? buffer->size - offset : 0;
+
+        write_entry(buffer->data + listing_offset + GEN_ENTRY_SIZE * i, name,
+            type, (uint32_t) size, (uint32_t) offset);
+    }
+
+    write_entry(buffer->data + listing_offset + GEN_ENTRY_SIZE *
+        number_of_entries, "", GEN_END_OF_DIRECTORY, 0, 0);
+}
+
+static void display_help_screen(void)
+{
+    printf(
+        "Usage:\n"
+        "        %s [options] -o file\n"
+        "\n"
+        "Options:\n"
+        "        -o file       write the synthetic archive to `file`\n"
+        "        -d [n=3]      nest directories `n` levels deep\n"
+        "        -n [n=3]      create `n` subdirectories per directory\n"
+        "        -f [n=4]      create `n` raw files per directory\n"
+        "        -w [n=2]      create `n` wads per directory\n"
+        "        -i [n=32]     store `n` images per wad\n"
+        "        -p [n=4]      store `n` palettes per wad\n"
+        "        -s [n=64]     make images up to `n`x`n` pixels\n"
+        "        -b [n=4096]   make raw files up to `n` bytes\n"
+        "        -r [n=50]     encode `n` percent of the images as rle\n"
+        "        -S [n=1]      seed the generator with `n`\n"
+        "\n",
+        GEN_EXECUTABLE_NAME);
+
+    exit(EXIT_SUCCESS);
+}
+
+static size_t parse_number(char const *argument)
+{
+    char *end = NULL;
+    unsigned long long value = strtoull(argument, &end, 10);
+
+    if (*argument == '\0' || *end != '\0') {
+        fail("invalid number");
+    }
+
+    return (size_t) value;
+}
+
+static void parse_command_line(int count, char **arguments)
+{
+    for (int i = 1; i < count; ++i) {
+        char const *argument = arguments[i];
+
+        if (argument[0] != '-' || argument[1] == '\0' || argument[2] != '\0') {
+            fail("invalid option");
+        }
+
+        if (argument[1] == 'h') {
+            display_help_screen();
+        }
+
+        if (i + 1 >= count) {
+            fail("missing option argument");
+        }
+
+        char const *value = arguments[++i];
+
+        switch (argument[1]) {
+        case 'o':
+            GEN_SETTINGS.output_filename = value;
+            break;
+
+        case 'd':
+            GEN_SETTINGS.depth = parse_number(value);
+            break;
+
+        case 'n':
+            GEN_SETTINGS.number_of_directories = parse_number(value);
+            break;
+
+        case 'f':
+            GEN_SETTINGS.number_of_files = parse_number(value);
+            break;
+
+        case 'w':
+            GEN_SETTINGS.number_of_wads = parse_number(value);
+            break;
+
+        case 'i':
+            GEN_SETTINGS.number_of_images = parse_number(value);
+            break;
+
+        case 'p':
+            GEN_SETTINGS.number_of_palettes = parse_number(value);
+            break;
+
+        case 's':
+            GEN_SETTINGS.image_size = parse_number(value);
+            break;
+
+        case 'b':
+            GEN_SETTINGS.file_size = parse_number(value);
+            break;
+
+        case 'r':
+            GEN_SETTINGS.rle_percentage = parse_number(value);
+            break;
+
+        case 'S':
+            GEN_SETTINGS.seed = parse_number(value);
+            break;
+
+        default:
+            fail("invalid option");
+        }
+    }
+
+    if (GEN_SETTINGS.output_filename == NULL) {
+        fail("no output file");
+    }
+
+    if (GEN_SETTINGS.number_of_palettes == 0 || GEN_SETTINGS.image_size == 0) {
+        fail("wads need at least one palette and one pixel");
+    }
+}
+
+int main(int count, char *arguments[])
+{
+    parse_command_line(count, arguments);
+
+    GEN_RANDOM_STATE = GEN_SETTINGS.seed * 0x9E3779B97F4A7C15 + 1;
+
+    buffer_t archive = { NULL, 0, 0 };
+
+    append_to_buffer(&archive, NULL, GEN_ENTRY_SIZE *
+        (GEN_SETTINGS.number_of_directories * (GEN_SETTINGS.depth > 0) +
+        GEN_SETTINGS.number_of_files + GEN_SETTINGS.number_of_wads + 1));
+
+    append_directory(&archive, 0, 0);
+
+    FILE *file = fopen(GEN_SETTINGS.output_filename, "wb");
+
+    if (file == NULL ||
+        fwrite(archive.data, archive.size, 1, file) != 1 ||
+        fclose(file) != 0) {
+        fail("unable to write the archive");
+    }
+
+    printf("%s: %zu bytes, %zu directories, %zu files, %zu wads, "
+        "%zu images (%zu rle)\n", GEN_SETTINGS.output_filename, archive.size,
+        GEN_STATISTICS.number_of_directories, GEN_STATISTICS.number_of_files,
+        GEN_STATISTICS.number_of_wads, GEN_STATISTICS.number_of_images,
+        GEN_STATISTICS.number_of_rle_images);
+
+    free(archive.data);
+    return EXIT_SUCCESS;
+}
@@ -1,23 +1,88 @@
+#if defined (__linux__)
+#define _GNU_SOURCE
+#endif
+
+#if defined (__unix__) || (defined (__APPLE__) && defined (__MACH__))
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdint.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdatomic.h>
 
 #include <string.h>
 #include <ctype.h>
 
 #include <signal.h>
+#include <setjmp.h>
+#include <errno.h>
+#include <time.h>
+
+#include "nme.h"
 
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_ONLY_BMP
+#include "stb_image.h"
+
 #if defined (__unix__) || (defined (__APPLE__) && defined (__MACH__))
 #include <strings.h>
+#define stricmp strcasecmp
 #define strnicmp strncasecmp
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define NME_POSIX
+#define NME_THREADS
+#else
+#include <direct.h>
+#endif
+
+#if defined (__linux__)
+#include <sys/sendfile.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#define NME_KERNEL_COPY
+
+#if defined (__has_include)
+#if __has_include (<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+
+#if defined (__NR_io_uring_setup)
+#define NME_IO_URING
+#endif
+#endif
+#endif
+#endif
+
+#if (defined (__x86_64__) || defined (__i386__)) && defined (__GNUC__)
+#include <immintrin.h>
+#define NME_X86_INTRINSICS
 #endif
 
 #define NME_VERSION_STRING "0.3"
+#if defined (NME_POSIX)
+#define NME_BUILD_FEATURES "unpack:dump:pack"
+#else
 #define NME_BUILD_FEATURES "unpack:dump"
+#endif
 
 #define NME_TRUE 1
 #define NME_FALSE 0
@@ -29,6 +94,24 @@
 #define NME_SILENT -1
 #define NME_VERBOSE 0
 
+#define NME_DEDUPLICATE_BY_LINKING 1
+#define NME_DEDUPLICATE_BY_CLONING 2
+
+#define NME_ASYNC_IO_RING 1
+#define NME_ASYNC_IO_THREADS 2
+
+#define NME_WRITE_JOB_OPENING 0
+#define NME_WRITE_JOB_WRITING 1
+#define NME_WRITE_JOB_CLOSING 2
+
+#define NME_TAR_BLOCK_SIZE 512
+#define NME_TAR_NAME_LENGTH 100
+#define NME_TAR_PREFIX_LENGTH 155
+
+#define NME_FILE_SOURCE 0
+#define NME_BMP_SOURCE 1
+#define NME_RLE_SOURCE 2
+
 #define NME_STRINGIFY(MACRO) #MACRO
 #define NME_EXPAND_AND_STRINGIFY(MACRO) NME_STRINGIFY(MACRO)
 
@@ -46,13 +129,72 @@
 #define NME_DEFAULT_ALIGNMENT
 
 typedef struct queue queue_t;
+typedef struct string_set string_set_t;
+
+typedef struct archive archive_t;
+typedef struct manifest manifest_t;
+
+typedef struct deduplicator deduplicator_t;
+typedef struct duplicate duplicate_t;
+
+typedef struct tar_stream tar_stream_t;
+
+typedef struct writer writer_t;
+typedef struct write_job write_job_t;
+typedef struct ring ring_t;
+
+typedef struct pack_directory pack_directory_t;
+typedef struct lookup lookup_t;
+
+typedef struct server server_t;
+typedef struct connection connection_t;
+
+typedef struct image_cache image_cache_t;
+typedef struct cached_image cached_image_t;
+typedef struct pack_entry pack_entry_t;
+typedef struct wad_builder wad_builder_t;
+
 typedef struct entry entry_t;
+typedef struct listing listing_t;
+
+typedef struct worker worker_t;
+typedef struct pool pool_t;
+
+typedef struct statistics statistics_t;
+
+typedef struct buffer buffer_t;
+
+typedef struct arena arena_t;
+typedef struct arena_chunk arena_chunk_t;
+typedef struct arena_mark arena_mark_t;
+
+typedef struct index index_t;
+typedef struct index_header index_header_t;
+typedef struct index_entry index_entry_t;
+typedef struct index_image index_image_t;
+
+typedef struct library_call library_call_t;
+
+typedef struct encoder encoder_t;
+typedef struct indexed_image indexed_image_t;
+typedef struct bit_stream bit_stream_t;
 
 typedef struct wad wad_t;
 typedef struct palette palette_t;
 typedef struct line_offsets line_offsets_t;
 typedef struct image image_t;
 
+typedef struct atlas_rect atlas_rect_t;
+typedef struct atlas_page atlas_page_t;
+
+#if defined (NME_THREADS)
+typedef pthread_mutex_t mutex_t;
+typedef pthread_cond_t condition_t;
+#else
+typedef int mutex_t;
+typedef int condition_t;
+#endif
+
 struct queue {
     size_t head;
     size_t tail;
@@ -60,7 +202,16 @@ struct queue {
     size_t size;
     size_t capacity;
 
-    entry_t *data;
+    entry_t const **data;
+    mutex_t mutex;
+};
+
+struct string_set {
+    size_t size;
+    size_t capacity;
+
+    char **data;
+    mutex_t mutex;
 };
 
 NME_PACK(1)
@@ -73,706 +224,8035 @@ struct entry {
     uint32_t size;
     uint32_t offset;
 
-    entry_t const *parent;
+    listing_t *parent;
 };
 
-struct wad {
-    uint32_t number_of_palettes;
-    palette_t *palettes;
+NME_PACK(NME_DEFAULT_ALIGNMENT)
+struct buffer {
+    uint8_t *data;
 
-    uint32_t number_of_images;
-    image_t *images;
+    size_t size;
+    size_t capacity;
+};
 
-    entry_t const *entry;
+struct arena_chunk {
+    arena_chunk_t *next;
+
+    size_t used;
+    size_t capacity;
+
+    uint8_t data[];
+};
+
+struct arena {
+    arena_chunk_t *head;
+    arena_chunk_t *current;
+};
+
+struct arena_mark {
+    arena_chunk_t *chunk;
+    size_t used;
 };
 
 NME_PACK(1)
-struct palette {
-    uint16_t colors[256];
-    char comment[13];
+struct index_header {
+    char magic[8];
+    uint32_t version;
+
+    uint32_t number_of_entries;
+    uint32_t number_of_images;
+    uint32_t number_of_slots;
+
+    uint64_t archive_size;
+    int64_t archive_modification_time;
+
+    uint64_t strings_size;
 };
 
-struct line_offsets {
-    uint32_t data_block_size;
+struct index_entry {
+    uint32_t path;
+    uint32_t parent;
 
-    uint8_t name[4];
+    uint32_t offset;
+    uint32_t size;
 
-    uint32_t width;
-    uint32_t height;
+    uint32_t first;
+    uint32_t count;
 
-    uint32_t *values;
+    int8_t type;
+    uint8_t unused[3];
 };
 
-NME_PACK(1)
-struct image {
-    char name[32];
+struct index_image {
+    uint32_t path;
+    uint32_t entry;
+
+    uint64_t header_offset;
 
+    uint64_t pixel_data_offset;
     uint64_t pixel_data_size;
-    uint32_t unused[2];
 
-    uint32_t height;
     uint32_t width;
+    uint32_t height;
 
+    uint32_t palette_id;
     uint16_t color_depth;
 
-    uint8_t *pixel_data;
-    line_offsets_t line_offsets;
+    uint8_t is_rle;
+    uint8_t unused;
+};
 
-    uint32_t palette_id;
+NME_PACK(NME_DEFAULT_ALIGNMENT)
+struct index {
+    index_header_t const *header;
+
+    index_entry_t const *entries;
+    index_image_t const *images;
 
-    wad_t const *parent;
+    uint32_t const *slots;
+    char const *strings;
+
+    void const *data;
+    size_t size;
+
+    int is_mapped;
 };
 
-static size_t const NME_QUEUE_CAPACITY = 4096;
+struct archive {
+    char const *filename;
+    char *output_path;
 
-static char const *NME_EXECUTABLE_NAME = NULL;
+    uint8_t const *data;
+    size_t size;
+    int64_t modification_time;
 
-static FILE *NME_INPUT_FILE = NULL;
-static char const *NME_INPUT_FILENAME = NULL;
+    int descriptor;
+    manifest_t *manifest;
 
-static FILE *NME_OUTPUT_FILE = NULL;
-static char const *NME_OUTPUT_PATH = NULL;
+    string_set_t *expanded_directories;
+};
 
-static char const NME_PATH_SEPARATOR = '/';
+struct manifest {
+    string_set_t *previous;
 
-static int NME_VERBOSITY = NME_SILENT;
+    buffer_t records;
+    mutex_t mutex;
+};
 
-static size_t NME_MAXIMUM_HEAP_USAGE = 0;
-static size_t NME_CURRENT_HEAP_USAGE = 0;
+struct duplicate {
+    uint64_t hash;
+    int kind;
 
-static void report(char const *message, ...)
-{
-    if (message == NULL) {
-        fprintf(stderr, "%s: unknown error\n", NME_EXECUTABLE_NAME);
-        return;
-    }
+    uint8_t const *data;
+    size_t size;
 
-    va_list arguments;
-    va_start(arguments, message);
+    palette_t const *palette;
+    uint32_t width;
+    uint32_t height;
 
-    char *buffer = malloc(1024);
+    char *path;
+};
 
-    vsnprintf(buffer, 1024, message, arguments);
-    fprintf(stderr, "%s: %s\n", NME_EXECUTABLE_NAME, buffer);
+struct deduplicator {
+    duplicate_t **duplicates;
 
-    free(buffer);
-    va_end(arguments);
-}
+    size_t capacity;
+    size_t count;
 
-static void fail(char const *message, ...)
-{
-    va_list arguments;
-    va_start(arguments, message);
+    mutex_t mutex;
+};
 
-    report(message, arguments);
+struct tar_stream {
+    FILE *file;
+    mutex_t mutex;
 
-    va_end(arguments);
-    exit(EXIT_FAILURE);
-}
+    int64_t modification_time;
+};
 
-static void die(char const *message, ...)
-{
-    va_list arguments;
-    va_start(arguments, message);
+struct write_job {
+    write_job_t *next;
 
-    report(message, arguments);
+    char const *filename;
+    uint8_t const *data;
+    size_t size;
 
-    va_end(arguments);
-    abort();
-}
+    size_t footprint;
 
-static void handle_signal(int signal_identifier)
-{
-    (void) signal_identifier;
+    int state;
+    int descriptor;
+    size_t written;
 
-    fprintf(stderr, "%s: aborting\n", NME_EXECUTABLE_NAME);
-    exit(EXIT_FAILURE);
-}
+    int has_failed;
+};
 
-static void *allocate(size_t size)
-{
-    size_t *memory = malloc(size + sizeof (size_t));
+#if defined (NME_IO_URING)
+struct ring {
+    int descriptor;
+    unsigned capacity;
+    unsigned unsubmitted;
 
-    if (memory == NULL) {
-        die("malloc(%lu) failed", size);
-    }
+    void *submissions;
+    size_t submissions_size;
 
-    NME_MAXIMUM_HEAP_USAGE += size;
-    NME_CURRENT_HEAP_USAGE += size;
+    void *completions;
+    size_t completions_size;
 
-    *(memory++) = size;
+    void *entries;
+    size_t entries_size;
 
-    return memset(memory, 0x00, size);
-}
+    atomic_uint *submission_head;
+    atomic_uint *submission_tail;
+    unsigned submission_mask;
+    unsigned *submission_array;
 
-static void release(void *memory)
-{
-    size_t *size = memory;
+    atomic_uint *completion_head;
+    atomic_uint *completion_tail;
+    unsigned completion_mask;
+    struct io_uring_cqe *completion_entries;
+};
+#endif
 
-    if (size == NULL) {
-        return;
-    }
+struct writer {
+    write_job_t *first;
+    write_job_t *last;
 
-    NME_CURRENT_HEAP_USAGE -= *(--size);
-    free(size);
-}
+    size_t backlog;
+    size_t maximum_backlog;
+    int is_closing;
 
-static char *prepend(char *string, char const *prefix, size_t length)
-{
-    NME_ASSERT(string != NULL && prefix != NULL);
+    mutex_t mutex;
+    condition_t condition;
 
-    memmove(string + length, string, strlen(string) + 1);
-    return strncpy(string, prefix, length);
-}
+    size_t number_of_threads;
 
-static uint8_t get_red(uint16_t color)
-{
-    float red = (float) ((color >> 11) & 0x1F);
-    return (uint8_t) (8.225806f * red);
-}
+    size_t number_of_failures;
+    char *first_failure;
 
-static uint8_t get_green(uint16_t color)
-{
-    float green = (float) ((color >> 5) & 0x3F);
-    return (uint8_t) (4.047619f * green);
-}
+#if defined (NME_THREADS)
+    pthread_t *threads;
+#endif
 
-static uint8_t get_blue(uint16_t color)
-{
-    float blue = (float) (color & 0x1F);
-    return (uint8_t) (8.225806f * blue);
-}
+#if defined (NME_IO_URING)
+    ring_t *ring;
+#endif
+};
 
-static queue_t *create_queue(size_t capacity)
-{
-    NME_ASSERT(capacity >= 1);
+struct pack_directory {
+    char *path;
 
-    queue_t *queue = allocate(sizeof (queue_t));
-    memset(queue, 0x00, sizeof (queue_t));
+    size_t reference;
+};
 
-    queue->data = allocate(sizeof (entry_t) * capacity);
+struct pack_entry {
+    entry_t entry;
+    char *path;
 
-    queue->capacity = capacity;
-    queue->tail = queue->capacity - 1;
+    int is_built;
+};
 
-    return queue;
-}
+struct wad_builder {
+    buffer_t images;
+    buffer_t palettes;
 
-static void free_queue(queue_t *queue)
-{
-    if (queue != NULL) {
-        release(queue->data);
-        memset(queue, 0x00, sizeof (queue_t));
-    }
+    uint16_t *slots;
+    size_t number_of_colors;
+};
 
-    release(queue);
-}
+struct nme_archive {
+    archive_t archive;
+    index_t *index;
 
-static void enqueue(queue_t *queue, entry_t const *entry)
-{
-    NME_ASSERT(queue != NULL && queue->data != NULL);
-    NME_ASSERT(queue->size + 1 < queue->capacity);
+    int is_mapped;
+};
 
-    queue->tail = (queue->tail + 1) % queue->capacity;
-    memmove(queue->data + queue->tail, entry, sizeof (entry_t));
+struct cached_image {
+    cached_image_t *newer;
+    cached_image_t *older;
+    cached_image_t *next;
 
-    ++queue->size;
-}
+    size_t archive;
+    uint32_t value;
+    encoder_t const *encoder;
 
-static entry_t const *dequeue(queue_t *queue)
-{
-    NME_ASSERT(queue != NULL && queue->data != NULL);
+    size_t references;
+    int is_cached;
 
-    entry_t const *entry = queue->data + queue->head;
-    queue->head = (queue->head + 1) % queue->capacity;
+    uint32_t width;
+    uint32_t height;
 
-    --queue->size;
+    size_t size;
+    uint8_t data[];
+};
 
-    return entry;
-}
+struct image_cache {
+    cached_image_t **slots;
+    size_t capacity;
 
-static int is_queue_empty(queue_t const *queue)
-{
-    NME_ASSERT(queue != NULL);
-    return (queue->size == 0);
-}
+    cached_image_t *newest;
+    cached_image_t *oldest;
 
-static int has_extension(char const *filename, char const *extension)
-{
-    NME_ASSERT(filename != NULL);
-    NME_ASSERT(extension != NULL);
+    size_t count;
+    size_t size;
+    size_t limit;
 
-    char *suffix = strrchr(filename, '.');
+    size_t hits;
+    size_t misses;
 
-    if (suffix != NULL) {
-        return strnicmp(++suffix, extension, strlen(extension)) == 0;
-    }
+    mutex_t mutex;
+};
+
+struct server {
+    char const **filenames;
+    nme_archive_t **archives;
+
+    size_t number_of_archives;
+
+    image_cache_t cache;
+};
+
+struct connection {
+    server_t *server;
+    int descriptor;
+
+    char *request;
+    int is_open;
+
+    buffer_t pixels;
+    buffer_t scanlines;
+    buffer_t encoded;
+};
+
+struct listing {
+    listing_t *next;
+
+    archive_t const *archive;
+
+    char const *path;
+    atomic_int descriptor;
+
+    size_t number_of_entries;
+    entry_t entries[];
+};
+
+struct worker {
+    size_t identifier;
+
+    queue_t *queue;
+    listing_t *listings;
+
+    arena_t arena;
+
+    buffer_t pixels;
+    buffer_t scanlines;
+    buffer_t encoded;
+
+    pool_t *pool;
+
+#if defined (NME_THREADS)
+    pthread_t thread;
+#endif
+};
+
+struct pool {
+    size_t number_of_workers;
+    worker_t *workers;
+
+    atomic_size_t queued;
+    atomic_size_t pending;
+    atomic_size_t idle;
+
+    mutex_t mutex;
+    condition_t condition;
+
+    size_t memory_in_flight;
+
+    mutex_t memory_mutex;
+    condition_t memory_condition;
+};
+
+struct statistics {
+    atomic_size_t bytes_read;
+    atomic_size_t entries_walked;
+    atomic_size_t directories_expanded;
+    atomic_size_t wads_parsed;
+    atomic_size_t bmp_images_decoded;
+    atomic_size_t rle_images_decoded;
+    atomic_size_t bytes_encoded;
+    atomic_size_t files_written;
+    atomic_size_t bytes_written;
+    atomic_size_t directories_created;
+    atomic_size_t files_skipped;
+    atomic_size_t images_skipped;
+    atomic_size_t images_indexed;
+    atomic_size_t files_deduplicated;
+    atomic_size_t images_deduplicated;
+    atomic_size_t bytes_deduplicated;
+    atomic_size_t memory_waits;
+
+    atomic_uint_fast64_t io_time;
+    atomic_uint_fast64_t decode_time;
+    atomic_uint_fast64_t encode_time;
+
+    uint64_t open_time;
+    uint64_t index_time;
+    uint64_t extract_time;
+    uint64_t total_time;
+};
+
+struct library_call {
+    nme_archive_t *handle;
+
+    char const *filename;
+    void const *data;
+    size_t size;
+
+    buffer_t entries;
+    buffer_t images;
+    buffer_t strings;
+    string_set_t *listings;
+
+    index_image_t const *image;
+    uint8_t *pixels;
+
+    arena_t arena;
+};
+
+struct encoder {
+    char const *name;
+    char const *extension;
+
+    int requires_alpha;
+
+    int (*encode)(buffer_t *, buffer_t *, uint8_t const *, size_t, size_t,
+        size_t);
+    int (*encode_indexed)(buffer_t *, buffer_t *, indexed_image_t const *);
+};
+
+struct indexed_image {
+    uint8_t const *indices;
+
+    size_t width;
+    size_t height;
+    size_t stride;
+
+    uint8_t palette[256][4];
+
+    size_t number_of_colors;
+    size_t number_of_alphas;
+};
+
+struct bit_stream {
+    uint8_t *cursor;
+
+    uint64_t bits;
+    unsigned count;
+};
+
+struct wad {
+    archive_t const *archive;
+
+    char const *path;
+    atomic_int descriptor;
+
+    uint32_t number_of_palettes;
+    palette_t const *palettes;
+    uint32_t *colors;
+
+    uint32_t number_of_images;
+    image_t *images;
+
+    entry_t const *entry;
+};
+
+NME_PACK(1)
+struct palette {
+    uint16_t colors[256];
+    char comment[13];
+};
+
+struct line_offsets {
+    uint32_t data_block_size;
+
+    uint8_t name[4];
+
+    uint32_t width;
+    uint32_t height;
+
+    uint32_t const *values;
+};
+
+NME_PACK(1)
+struct image {
+    char name[32];
+
+    uint64_t pixel_data_size;
+    uint32_t unused[2];
+
+    uint32_t height;
+    uint32_t width;
+
+    uint16_t color_depth;
+
+    uint8_t const *pixel_data;
+    line_offsets_t line_offsets;
+
+    uint32_t palette_id;
+
+    wad_t *parent;
+};
+
+NME_PACK(NME_DEFAULT_ALIGNMENT)
+
+struct lookup {
+    entry_t entry;
+    char const *directory;
+
+    int is_image;
+    image_t image;
+};
+
+struct atlas_rect {
+    image_t image;
+    uint32_t index;
+
+    uint32_t page;
+    uint32_t x;
+    uint32_t y;
+};
+
+struct atlas_page {
+    uint32_t width;
+    uint32_t height;
+};
+
+static size_t const NME_QUEUE_CAPACITY = 4096;
+static size_t const NME_STRING_SET_CAPACITY = 1024;
+static size_t const NME_ARENA_CHUNK_SIZE = 65536;
+static size_t const NME_ATLAS_PADDING = 1;
+static size_t const NME_DEFAULT_ATLAS_SIZE = 2048;
+static size_t const NME_MAXIMUM_ATLAS_SIZE = 16384;
+
+static size_t const NME_MAXIMUM_NAME_LENGTH = 32;
+static size_t const NME_MAXIMUM_RLE_SIZE = 16384;
+
+static int const NME_UNOPENED_DESCRIPTOR = -2;
+static size_t const NME_MAXIMUM_OPEN_DIRECTORIES = 256;
+
+static size_t const NME_COPY_CHUNK_SIZE = 1 << 20;
+
+static size_t const NME_NUMBER_OF_WRITER_THREADS = 4;
+static unsigned const NME_RING_CAPACITY = 64;
+static size_t const NME_WRITER_BACKLOG = 64 << 20;
+
+static size_t const NME_DEFAULT_CACHE_LIMIT = 64 << 20;
+static size_t const NME_CACHED_IMAGE_SIZE = 16384;
+static size_t const NME_MAXIMUM_CACHE_SLOTS = 1 << 20;
+static size_t const NME_MAXIMUM_REQUEST_LENGTH = 4096;
+static size_t const NME_PREALLOCATION_THRESHOLD = 1 << 20;
+
+static uint16_t const NME_LENGTH_BASES[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+    67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static uint8_t const NME_LENGTH_EXTRA_BITS[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4,
+    5, 5, 5, 5, 0
+};
+
+static uint16_t const NME_DISTANCE_BASES[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513,
+    769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static uint8_t const NME_DISTANCE_EXTRA_BITS[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10,
+    11, 11, 12, 12, 13, 13
+};
+
+static size_t const NME_MAXIMUM_MATCH_LENGTH = 258;
+static size_t const NME_MAXIMUM_MATCH_DISTANCE = 32768;
+static size_t const NME_MAXIMUM_STORED_BLOCK_SIZE = 65535;
+
+static uint64_t const NME_HASH_PRIMES[5] = {
+    0x9E3779B185EBCA87, 0xC2B2AE3D27D4EB4F, 0x165667B19E3779F9,
+    0x85EBCA77C2B2AE63, 0x27D4EB2F165667C5
+};
+
+static char const NME_INDEX_MAGIC[8] = "NMEINDEX";
+static uint32_t const NME_INDEX_VERSION = 1;
+static uint32_t const NME_INDEX_ROOT = UINT32_MAX;
+
+static char const *NME_MANIFEST_NAME = ".nme-manifest";
+static uint32_t const NME_MANIFEST_VERSION = 1;
+
+static char const *NME_EXECUTABLE_NAME = "nme";
+
+static buffer_t NME_INPUT_FILENAMES = { NULL, 0, 0 };
+
+static buffer_t NME_SELECTION_PATTERNS = { NULL, 0, 0 };
+
+static char const *NME_INDEX_FILENAME = NULL;
+static char const *NME_LOOKUP_PATH = NULL;
+static int NME_BUILD_INDEX = NME_FALSE;
+
+static int NME_INCREMENTAL = NME_FALSE;
+
+static int NME_DEDUPLICATION = NME_FALSE;
+static deduplicator_t *NME_DEDUPLICATOR = NULL;
+
+static int NME_ASYNC_IO = NME_FALSE;
+static writer_t *NME_WRITER = NULL;
+
+static char const *NME_TAR_FILENAME = NULL;
+static tar_stream_t *NME_TAR_STREAM = NULL;
+
+static char const *NME_PACK_PATH = NULL;
+static size_t NME_PACK_ALIGNMENT = 1;
+
+static char const *NME_SERVER_PATH = NULL;
+static size_t NME_CACHE_LIMIT = NME_DEFAULT_CACHE_LIMIT;
+
+static char const *NME_OUTPUT_PATH = NULL;
+
+static char const NME_PATH_SEPARATOR = '/';
+
+static int NME_VERBOSITY = NME_SILENT;
+
+static string_set_t *NME_CREATED_DIRECTORIES = NULL;
+
+static int NME_USE_OPENAT = NME_FALSE;
+static atomic_size_t NME_NUMBER_OF_OPEN_DIRECTORIES = 0;
+
+static void (*NME_CONVERT_ROW_TO_RGB)(uint8_t *, uint8_t const *, size_t,
+    uint32_t const *) = NULL;
+
+static void (*NME_CONVERT_ROW_TO_RGBA)(uint8_t *, uint8_t const *, size_t,
+    uint32_t const *, uint8_t) = NULL;
+
+static size_t NME_NUMBER_OF_WORKERS = 1;
+static size_t NME_MEMORY_LIMIT = 0;
+static size_t NME_ATLAS_SIZE = 0;
+
+static int NME_COLLECT_STATISTICS = NME_FALSE;
+static char const *NME_STATISTICS_FILENAME = NULL;
+static statistics_t NME_STATISTICS;
+
+static encoder_t const *NME_ENCODER = NULL;
+static int NME_INDEXED_OUTPUT = NME_FALSE;
+static int NME_PNG_COMPRESSION_LEVEL = -1;
+
+static uint32_t NME_CRC_TABLE[256];
+
+static uint16_t NME_FIXED_LITERAL_CODES[288];
+static uint8_t NME_FIXED_LITERAL_LENGTHS[288];
+static uint8_t NME_LENGTH_SYMBOLS[259];
+
+static atomic_size_t NME_MAXIMUM_HEAP_USAGE = 0;
+static atomic_size_t NME_CURRENT_HEAP_USAGE = 0;
+
+static _Thread_local jmp_buf *NME_RECOVERY_POINT = NULL;
+static _Thread_local nme_status_t NME_RECOVERY_STATUS = NME_OK;
+
+#if defined (NME_THREADS)
+static pthread_once_t NME_LIBRARY_INITIALIZATION = PTHREAD_ONCE_INIT;
+#endif
+
+static void report_arguments(char const *message, va_list arguments)
+{
+    if (message == NULL) {
+        fprintf(stderr, "%s: unknown error\n", NME_EXECUTABLE_NAME);
+        return;
+    }
+
+    char *buffer = malloc(1024);
+
+    vsnprintf(buffer, 1024, message, arguments);
+    fprintf(stderr, "%s: %s\n", NME_EXECUTABLE_NAME, buffer);
+
+    free(buffer);
+}
+
+static void report(char const *message, ...)
+{
+    va_list arguments;
+    va_start(arguments, message);
+
+    report_arguments(message, arguments);
+
+    va_end(arguments);
+}
+
+static void escape(nme_status_t status)
+{
+    if (NME_RECOVERY_POINT == NULL) {
+        return;
+    }
+
+    NME_RECOVERY_STATUS = status;
+    longjmp(*NME_RECOVERY_POINT, 1);
+}
+
+static void fail(char const *message, ...)
+{
+    escape(NME_ERROR_CORRUPT);
+
+    va_list arguments;
+    va_start(arguments, message);
+
+    report_arguments(message, arguments);
+
+    va_end(arguments);
+    exit(EXIT_FAILURE);
+}
+
+static void die(char const *message, ...)
+{
+    escape(NME_ERROR_CORRUPT);
+
+    va_list arguments;
+    va_start(arguments, message);
+
+    report_arguments(message, arguments);
+
+    va_end(arguments);
+    abort();
+}
+
+static void handle_signal(int signal_identifier)
+{
+    (void) signal_identifier;
+
+    fprintf(stderr, "%s: aborting\n", NME_EXECUTABLE_NAME);
+    exit(EXIT_FAILURE);
+}
+
+static void *allocate_uninitialized(size_t size)
+{
+    size_t *memory = malloc(size + sizeof (size_t));
+
+    if (memory == NULL) {
+        escape(NME_ERROR_OUT_OF_MEMORY);
+        die("malloc(%lu) failed", size);
+    }
+
+    size_t usage = atomic_fetch_add(&NME_CURRENT_HEAP_USAGE, size) + size;
+    size_t peak = atomic_load(&NME_MAXIMUM_HEAP_USAGE);
+
+    while (usage > peak && atomic_compare_exchange_weak(
+        &NME_MAXIMUM_HEAP_USAGE, &peak, usage) == NME_FALSE) {
+    }
+
+    *(memory++) = size;
+
+    return memory;
+}
+
+static void *allocate(size_t size)
+{
+    return memset(allocate_uninitialized(size), 0x00, size);
+}
+
+static void release(void *memory)
+{
+    size_t *size = memory;
+
+    if (size == NULL) {
+        return;
+    }
+
+    atomic_fetch_sub(&NME_CURRENT_HEAP_USAGE, *(--size));
+    free(size);
+}
+
+static void *allocate_from_arena(arena_t *arena, size_t size)
+{
+    NME_ASSERT(arena != NULL);
+
+    size = (size + 7) & ~(size_t) 7;
+    arena_chunk_t *chunk = arena->current;
+
+    if (chunk == NULL || size > chunk->capacity - chunk->used) {
+        arena_chunk_t **link = (chunk != NULL) ? &chunk->next : &arena->head;
+
+        while (*link != NULL && (*link)->capacity < size) {
+            link = &(*link)->next;
+        }
+
+        if (*link == NULL) {
+            size_t capacity = (size > NME_ARENA_CHUNK_SIZE) ? size :
+                NME_ARENA_CHUNK_SIZE;
+
+            *link = allocate_uninitialized(sizeof (arena_chunk_t) + capacity);
+
+            (*link)->next = NULL;
+            (*link)->capacity = capacity;
+        }
+
+        chunk = arena->current = *link;
+        chunk->used = 0;
+    }
+
+    void *memory = chunk->data + chunk->used;
+    chunk->used += size;
+
+    return memory;
+}
+
+static arena_mark_t mark_arena(arena_t const *arena)
+{
+    NME_ASSERT(arena != NULL);
+
+    arena_mark_t mark = { arena->current, 0 };
+
+    if (arena->current != NULL) {
+        mark.used = arena->current->used;
+    }
+
+    return mark;
+}
+
+static void rewind_arena(arena_t *arena, arena_mark_t mark)
+{
+    NME_ASSERT(arena != NULL);
+
+    arena->current = mark.chunk;
+
+    if (mark.chunk != NULL) {
+        mark.chunk->used = mark.used;
+    }
+}
+
+static void reset_arena(arena_t *arena)
+{
+    NME_ASSERT(arena != NULL);
+
+    arena->current = NULL;
+}
+
+static void free_arena(arena_t *arena)
+{
+    if (arena == NULL) {
+        return;
+    }
+
+    while (arena->head != NULL) {
+        arena_chunk_t *next = arena->head->next;
+
+        release(arena->head);
+        arena->head = next;
+    }
+
+    arena->current = NULL;
+}
+
+static void create_mutex(mutex_t *mutex)
+{
+    NME_ASSERT(mutex != NULL);
+
+#if defined (NME_THREADS)
+    if (pthread_mutex_init(mutex, NULL) != 0) {
+        die("pthread_mutex_init() failed");
+    }
+#else
+    *mutex = 0;
+#endif
+}
+
+static void free_mutex(mutex_t *mutex)
+{
+#if defined (NME_THREADS)
+    pthread_mutex_destroy(mutex);
+#else
+    (void) mutex;
+#endif
+}
+
+static void lock_mutex(mutex_t *mutex)
+{
+#if defined (NME_THREADS)
+    pthread_mutex_lock(mutex);
+#else
+    (void) mutex;
+#endif
+}
+
+static void unlock_mutex(mutex_t *mutex)
+{
+#if defined (NME_THREADS)
+    pthread_mutex_unlock(mutex);
+#else
+    (void) mutex;
+#endif
+}
+
+static void create_condition(condition_t *condition)
+{
+    NME_ASSERT(condition != NULL);
+
+#if defined (NME_THREADS)
+    if (pthread_cond_init(condition, NULL) != 0) {
+        die("pthread_cond_init() failed");
+    }
+#else
+    *condition = 0;
+#endif
+}
+
+static void free_condition(condition_t *condition)
+{
+#if defined (NME_THREADS)
+    pthread_cond_destroy(condition);
+#else
+    (void) condition;
+#endif
+}
+
+static void wait_for_condition(condition_t *condition, mutex_t *mutex)
+{
+#if defined (NME_THREADS)
+    pthread_cond_wait(condition, mutex);
+#else
+    (void) condition;
+    (void) mutex;
+#endif
+}
+
+static void broadcast_condition(condition_t *condition)
+{
+#if defined (NME_THREADS)
+    pthread_cond_broadcast(condition);
+#else
+    (void) condition;
+#endif
+}
+
+static size_t get_number_of_processors(void)
+{
+#if defined (NME_POSIX)
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (count > 0) {
+        return (size_t) count;
+    }
+#endif
+
+    return 1;
+}
+
+static uint64_t get_time(void)
+{
+    struct timespec time;
+
+#if defined (NME_POSIX)
+    clock_gettime(CLOCK_MONOTONIC, &time);
+#else
+    timespec_get(&time, TIME_UTC);
+#endif
+
+    return (uint64_t) time.tv_sec * 1000000000 + (uint64_t) time.tv_nsec;
+}
+
+static uint64_t start_timer(void)
+{
+    return (NME_COLLECT_STATISTICS == NME_TRUE) ? get_time() : 0;
+}
+
+static void stop_timer(atomic_uint_fast64_t *counter, uint64_t start)
+{
+    if (NME_COLLECT_STATISTICS == NME_TRUE) {
+        atomic_fetch_add_explicit(counter, get_time() - start,
+            memory_order_relaxed);
+    }
+}
+
+static void add_to_statistic(atomic_size_t *counter, size_t amount)
+{
+    if (NME_COLLECT_STATISTICS == NME_TRUE) {
+        atomic_fetch_add_explicit(counter, amount, memory_order_relaxed);
+    }
+}
+
+static uint8_t get_red(uint16_t color)
+{
+    uint32_t red = (color >> 11) & 0x1F;
+    return (uint8_t) ((red * 255 + 15) / 31);
+}
+
+static uint8_t get_green(uint16_t color)
+{
+    uint32_t green = (color >> 5) & 0x3F;
+    return (uint8_t) ((green * 255 + 31) / 63);
+}
+
+static uint8_t get_blue(uint16_t color)
+{
+    uint32_t blue = color & 0x1F;
+    return (uint8_t) ((blue * 255 + 15) / 31);
+}
+
+static uint32_t *expand_palettes(arena_t *arena, palette_t const *palettes,
+    uint32_t number_of_palettes)
+{
+    NME_ASSERT(palettes != NULL);
+
+    uint32_t *colors = allocate_from_arena(arena, sizeof (uint32_t) * 256 *
+        (size_t) number_of_palettes);
+
+    for (size_t i = 0; i < 256 * (size_t) number_of_palettes; ++i) {
+        uint16_t color = palettes[i >> 8].colors[i & 0xFF];
+
+        uint8_t rgba[4] = {
+            get_red(color), get_green(color), get_blue(color), 255
+        };
+
+        memcpy(&colors[i], rgba, sizeof (uint32_t));
+    }
+
+    return colors;
+}
+
+static void convert_row_to_rgb_scalar(uint8_t *destination,
+    uint8_t const *source, size_t width, uint32_t const *colors)
+{
+    for (size_t x = 0; x < width; ++x, destination += 3) {
+        memcpy(destination, &colors[source[x]], 3);
+    }
+}
+
+static void convert_row_to_rgba_scalar(uint8_t *destination,
+    uint8_t const *source, size_t width, uint32_t const *colors,
+    uint8_t alpha)
+{
+    for (size_t x = 0; x < width; ++x, destination += 4) {
+        memcpy(destination, &colors[source[x]], 4);
+        destination[3] = alpha;
+    }
+}
+
+#if defined (NME_X86_INTRINSICS)
+__attribute__ ((target ("ssse3")))
+static void convert_row_to_rgb_ssse3(uint8_t *destination,
+    uint8_t const *source, size_t width, uint32_t const *colors)
+{
+    __m128i const shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12,
+        13, 14, -1, -1, -1, -1);
+
+    size_t x = 0;
+
+    for (; x + 6 <= width; x += 4, destination += 12) {
+        __m128i rgba = _mm_setr_epi32((int) colors[source[x + 0]],
+            (int) colors[source[x + 1]], (int) colors[source[x + 2]],
+            (int) colors[source[x + 3]]);
+
+        _mm_storeu_si128((__m128i *) destination,
+            _mm_shuffle_epi8(rgba, shuffle));
+    }
+
+    convert_row_to_rgb_scalar(destination, source + x, width - x, colors);
+}
+
+__attribute__ ((target ("avx2")))
+static void convert_row_to_rgb_avx2(uint8_t *destination,
+    uint8_t const *source, size_t width, uint32_t const *colors)
+{
+    __m256i const shuffle = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12,
+        13, 14, -1, -1, -1, -1, 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1,
+        -1, -1, -1);
+
+    size_t x = 0;
+
+    for (; x + 10 <= width; x += 8, destination += 24) {
+        __m256i indices = _mm256_cvtepu8_epi32(
+            _mm_loadl_epi64((__m128i const *) (source + x)));
+
+        __m256i rgb = _mm256_shuffle_epi8(
+            _mm256_i32gather_epi32((int const *) colors, indices, 4),
+            shuffle);
+
+        _mm_storeu_si128((__m128i *) destination,
+            _mm256_castsi256_si128(rgb));
+        _mm_storeu_si128((__m128i *) (destination + 12),
+            _mm256_extracti128_si256(rgb, 1));
+    }
+
+    convert_row_to_rgb_scalar(destination, source + x, width - x, colors);
+}
+
+__attribute__ ((target ("avx2")))
+static void convert_row_to_rgba_avx2(uint8_t *destination,
+    uint8_t const *source, size_t width, uint32_t const *colors,
+    uint8_t alpha)
+{
+    __m256i const color_mask = _mm256_set1_epi32(0x00FFFFFF);
+    __m256i const alpha_mask = _mm256_set1_epi32(
+        (int) ((uint32_t) alpha << 24));
+
+    size_t x = 0;
+
+    for (; x + 8 <= width; x += 8, destination += 32) {
+        __m256i indices = _mm256_cvtepu8_epi32(
+            _mm_loadl_epi64((__m128i const *) (source + x)));
+
+        __m256i rgba = _mm256_i32gather_epi32((int const *) colors, indices, 4);
+        rgba = _mm256_or_si256(_mm256_and_si256(rgba, color_mask), alpha_mask);
+
+        _mm256_storeu_si256((__m256i *) destination, rgba);
+    }
+
+    convert_row_to_rgba_scalar(destination, source + x, width - x, colors,
+        alpha);
+}
+#endif
+
+static void select_row_converters(void)
+{
+    NME_CONVERT_ROW_TO_RGB = convert_row_to_rgb_scalar;
+    NME_CONVERT_ROW_TO_RGBA = convert_row_to_rgba_scalar;
+
+#if defined (NME_X86_INTRINSICS)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("ssse3")) {
+        NME_CONVERT_ROW_TO_RGB = convert_row_to_rgb_ssse3;
+    }
+
+    if (__builtin_cpu_supports("avx2")) {
+        NME_CONVERT_ROW_TO_RGB = convert_row_to_rgb_avx2;
+        NME_CONVERT_ROW_TO_RGBA = convert_row_to_rgba_avx2;
+    }
+#endif
+}
+
+static queue_t *create_queue(size_t capacity)
+{
+    NME_ASSERT(capacity >= 1);
+
+    queue_t *queue = allocate(sizeof (queue_t));
+    memset(queue, 0x00, sizeof (queue_t));
+
+    queue->data = allocate(sizeof (entry_t const *) * capacity);
+
+    queue->capacity = capacity;
+    queue->tail = queue->capacity - 1;
+
+    create_mutex(&queue->mutex);
+
+    return queue;
+}
+
+static void free_queue(queue_t *queue)
+{
+    if (queue != NULL) {
+        free_mutex(&queue->mutex);
+        release(queue->data);
+
+        memset(queue, 0x00, sizeof (queue_t));
+    }
+
+    release(queue);
+}
+
+static void grow_queue(queue_t *queue)
+{
+    NME_ASSERT(queue != NULL && queue->data != NULL);
+
+    size_t capacity = queue->capacity << 1;
+    entry_t const **data = allocate(sizeof (entry_t const *) * capacity);
+
+    for (size_t i = 0; i < queue->size; ++i) {
+        data[i] = queue->data[(queue->head + i) % queue->capacity];
+    }
+
+    release(queue->data);
+
+    queue->data = data;
+    queue->capacity = capacity;
+
+    queue->head = 0;
+    queue->tail = (queue->size + capacity - 1) % capacity;
+}
+
+static void enqueue(queue_t *queue, entry_t const *entry)
+{
+    NME_ASSERT(queue != NULL && queue->data != NULL);
+    NME_ASSERT(entry != NULL);
+
+    lock_mutex(&queue->mutex);
+
+    if (queue->size + 1 >= queue->capacity) {
+        grow_queue(queue);
+    }
+
+    queue->tail = (queue->tail + 1) % queue->capacity;
+    queue->data[queue->tail] = entry;
+
+    ++queue->size;
+
+    unlock_mutex(&queue->mutex);
+}
+
+static entry_t const *dequeue(queue_t *queue)
+{
+    NME_ASSERT(queue != NULL && queue->data != NULL);
+
+    entry_t const *entry = NULL;
+    lock_mutex(&queue->mutex);
+
+    if (queue->size != 0) {
+        entry = queue->data[queue->head];
+        queue->head = (queue->head + 1) % queue->capacity;
+
+        --queue->size;
+    }
+
+    unlock_mutex(&queue->mutex);
+    return entry;
+}
+
+static entry_t const *steal(queue_t *queue)
+{
+    NME_ASSERT(queue != NULL && queue->data != NULL);
+
+    entry_t const *entry = NULL;
+    lock_mutex(&queue->mutex);
+
+    if (queue->size != 0) {
+        entry = queue->data[queue->tail];
+        queue->tail = (queue->tail + queue->capacity - 1) % queue->capacity;
+
+        --queue->size;
+    }
+
+    unlock_mutex(&queue->mutex);
+    return entry;
+}
+
+static void reserve_buffer(buffer_t *buffer, size_t size)
+{
+    NME_ASSERT(buffer != NULL);
+
+    if (size <= buffer->capacity - buffer->size) {
+        return;
+    }
+
+    size_t capacity = (buffer->capacity != 0) ? buffer->capacity : 4096;
+
+    while (capacity - buffer->size < size) {
+        capacity <<= 1;
+    }
+
+    uint8_t *data = allocate_uninitialized(capacity);
+
+    if (buffer->size != 0) {
+        memcpy(data, buffer->data, buffer->size);
+    }
+
+    release(buffer->data);
+
+    buffer->data = data;
+    buffer->capacity = capacity;
+}
+
+static void *append_to_buffer(buffer_t *buffer, void const *data, size_t size)
+{
+    reserve_buffer(buffer, size);
+
+    uint8_t *destination = buffer->data + buffer->size;
+    buffer->size += size;
+
+    if (data != NULL) {
+        memcpy(destination, data, size);
+    }
+
+    return destination;
+}
+
+static void *reserve_scratch(buffer_t *scratch, size_t size)
+{
+    NME_ASSERT(scratch != NULL);
+
+    scratch->size = 0;
+    reserve_buffer(scratch, size);
+
+    return scratch->data;
+}
+
+static void free_buffer(buffer_t *buffer)
+{
+    if (buffer != NULL) {
+        release(buffer->data);
+        memset(buffer, 0x00, sizeof (buffer_t));
+    }
+}
+
+static uint64_t hash_string(char const *string, size_t length)
+{
+    uint64_t hash = 0xCBF29CE484222325;
+
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ (uint8_t) string[i]) * 0x100000001B3;
+    }
+
+    return hash;
+}
+
+static uint64_t rotate_left(uint64_t value, unsigned count)
+{
+    return (value << count) | (value >> (64 - count));
+}
+
+static uint64_t read_hash_lane(uint8_t const *data)
+{
+    uint64_t lane;
+    memcpy(&lane, data, sizeof (uint64_t));
+
+    return lane;
+}
+
+static uint64_t mix_hash_lane(uint64_t accumulator, uint64_t lane)
+{
+    accumulator += lane * NME_HASH_PRIMES[1];
+    return rotate_left(accumulator, 31) * NME_HASH_PRIMES[0];
+}
+
+static uint64_t merge_hash_lane(uint64_t hash, uint64_t accumulator)
+{
+    hash ^= mix_hash_lane(0, accumulator);
+    return hash * NME_HASH_PRIMES[0] + NME_HASH_PRIMES[3];
+}
+
+static uint64_t hash_data(uint64_t seed, void const *data, size_t size)
+{
+    NME_ASSERT(data != NULL || size == 0);
+
+    uint8_t const *cursor = data;
+    uint8_t const *end = cursor + size;
+
+    uint64_t hash = seed + NME_HASH_PRIMES[4];
+
+    if (size >= 32) {
+        uint64_t lanes[4] = {
+            seed + NME_HASH_PRIMES[0] + NME_HASH_PRIMES[1],
+            seed + NME_HASH_PRIMES[1], seed, seed - NME_HASH_PRIMES[0]
+        };
+
+        for (; end - cursor >= 32; cursor += 32) {
+            for (size_t i = 0; i < 4; ++i) {
+                lanes[i] = mix_hash_lane(lanes[i],
+                    read_hash_lane(cursor + 8 * i));
+            }
+        }
+
+        hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) +
+            rotate_left(lanes[2], 12) + rotate_left(lanes[3], 18);
+
+        for (size_t i = 0; i < 4; ++i) {
+            hash = merge_hash_lane(hash, lanes[i]);
+        }
+    }
+
+    hash += size;
+
+    for (; end - cursor >= 8; cursor += 8) {
+        hash ^= mix_hash_lane(0, read_hash_lane(cursor));
+        hash = rotate_left(hash, 27) * NME_HASH_PRIMES[0] + NME_HASH_PRIMES[3];
+    }
+
+    if (end - cursor >= 4) {
+        uint32_t lane;
+        memcpy(&lane, cursor, sizeof (uint32_t));
+
+        hash ^= lane * NME_HASH_PRIMES[0];
+        hash = rotate_left(hash, 23) * NME_HASH_PRIMES[1] + NME_HASH_PRIMES[2];
+
+        cursor += 4;
+    }
+
+    for (; cursor < end; ++cursor) {
+        hash ^= *cursor * NME_HASH_PRIMES[4];
+        hash = rotate_left(hash, 11) * NME_HASH_PRIMES[0];
+    }
+
+    hash ^= hash >> 33;
+    hash *= NME_HASH_PRIMES[1];
+    hash ^= hash >> 29;
+    hash *= NME_HASH_PRIMES[2];
+
+    return hash ^ (hash >> 32);
+}
+
+static string_set_t *create_string_set(size_t capacity)
+{
+    NME_ASSERT(capacity >= 1 && (capacity & (capacity - 1)) == 0);
+
+    string_set_t *set = allocate(sizeof (string_set_t));
+
+    set->data = allocate(sizeof (char *) * capacity);
+    set->capacity = capacity;
+
+    create_mutex(&set->mutex);
+
+    return set;
+}
+
+static void free_string_set(string_set_t *set)
+{
+    if (set == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < set->capacity; ++i) {
+        release(set->data[i]);
+    }
+
+    free_mutex(&set->mutex);
+
+    release(set->data);
+    release(set);
+}
+
+static char **find_slot_in_string_set(string_set_t const *set,
+    char const *string, size_t length)
+{
+    size_t mask = set->capacity - 1;
+    size_t index = hash_string(string, length) & mask;
+
+    for (;; index = (index + 1) & mask) {
+        char *candidate = set->data[index];
+
+        if (candidate == NULL || (strncmp(candidate, string, length) == 0 &&
+            candidate[length] == '\0')) {
+            return &set->data[index];
+        }
+    }
+}
+
+static void grow_string_set(string_set_t *set)
+{
+    NME_ASSERT(set != NULL);
+
+    char **data = set->data;
+    size_t capacity = set->capacity;
+
+    set->capacity = capacity << 1;
+    set->data = allocate(sizeof (char *) * set->capacity);
+
+    for (size_t i = 0; i < capacity; ++i) {
+        if (data[i] != NULL) {
+            *find_slot_in_string_set(set, data[i], strlen(data[i])) = data[i];
+        }
+    }
+
+    release(data);
+}
+
+static char const *find_string(string_set_t *set, char const *string,
+    size_t length)
+{
+    NME_ASSERT(set != NULL && string != NULL);
+
+    lock_mutex(&set->mutex);
+    char const *result = *find_slot_in_string_set(set, string, length);
+    unlock_mutex(&set->mutex);
+
+    return result;
+}
+
+static char const *insert_string(string_set_t *set, char const *string,
+    size_t length)
+{
+    NME_ASSERT(set != NULL && string != NULL);
+
+    lock_mutex(&set->mutex);
+
+    if ((set->size + 1) << 1 > set->capacity) {
+        grow_string_set(set);
+    }
+
+    char **slot = find_slot_in_string_set(set, string, length);
+
+    if (*slot == NULL) {
+        *slot = memcpy(allocate(length + 1), string, length);
+        ++set->size;
+    }
+
+    char const *result = *slot;
+    unlock_mutex(&set->mutex);
+
+    return result;
+}
+
+static int insert_new_string(string_set_t *set, char const *string,
+    size_t length)
+{
+    NME_ASSERT(set != NULL && string != NULL);
+
+    lock_mutex(&set->mutex);
+
+    if ((set->size + 1) << 1 > set->capacity) {
+        grow_string_set(set);
+    }
+
+    char **slot = find_slot_in_string_set(set, string, length);
+    int const is_new = (*slot == NULL);
+
+    if (is_new == NME_TRUE) {
+        *slot = memcpy(allocate(length + 1), string, length);
+        ++set->size;
+    }
+
+    unlock_mutex(&set->mutex);
+
+    return is_new;
+}
+
+static int has_extension(char const *filename, char const *extension)
+{
+    NME_ASSERT(filename != NULL);
+    NME_ASSERT(extension != NULL);
+
+    char *suffix = strrchr(filename, '.');
+
+    if (suffix != NULL) {
+        return strnicmp(++suffix, extension, strlen(extension)) == 0;
+    }
+
+    return NME_FALSE;
+}
+
+static char *join_paths(arena_t *arena, char const *first,
+    char const *second, char const *third, size_t spare)
+{
+    char const *const components[3] = { first, second, third };
+    size_t lengths[3] = { 0, 0, 0 };
+
+    size_t length = 0;
+
+    for (size_t i = 0; i < 3; ++i) {
+        if (components[i] != NULL) {
+            lengths[i] = strlen(components[i]);
+            length += lengths[i] + 1;
+        }
+    }
+
+    char *path = allocate_from_arena(arena, length + spare + 1);
+    char *cursor = path;
+
+    for (size_t i = 0; i < 3; ++i) {
+        if (lengths[i] == 0) {
+            continue;
+        }
+
+        if (cursor != path) {
+            *(cursor++) = NME_PATH_SEPARATOR;
+        }
+
+        memcpy(cursor, components[i], lengths[i]);
+        cursor += lengths[i];
+    }
+
+    *cursor = '\0';
+    return path;
+}
+
+static char *get_archive_path_for_entry(arena_t *arena, entry_t const *entry,
+    size_t spare)
+{
+    NME_ASSERT(entry != NULL && entry->parent != NULL);
+    return join_paths(arena, entry->parent->path, entry->name, NULL, spare);
+}
+
+static char *get_path_for_entry(arena_t *arena, entry_t const *entry)
+{
+    NME_ASSERT(entry != NULL && entry->parent != NULL);
+
+    char const *output_path = entry->parent->archive->output_path;
+
+    if (output_path == NULL) {
+        return join_paths(arena, NULL, NULL, NULL, 0);
+    }
+
+    return join_paths(arena, output_path, entry->parent->path, entry->name,
+        0);
+}
+
+static size_t get_segment_length(char const *path)
+{
+    size_t length = 0;
+
+    while (path[length] != '\0' && path[length] != NME_PATH_SEPARATOR) {
+        ++length;
+    }
+
+    return length;
+}
+
+static int match_segment(char const *pattern, size_t pattern_length,
+    char const *name, size_t name_length)
+{
+    size_t p = 0, n = 0;
+    size_t star = SIZE_MAX, resume = 0;
+
+    while (n < name_length) {
+        if (p < pattern_length && (pattern[p] == '?' ||
+            tolower((unsigned char) pattern[p]) ==
+            tolower((unsigned char) name[n]))) {
+            ++p;
+            ++n;
+        } else if (p < pattern_length && pattern[p] == '*') {
+            star = p++;
+            resume = n;
+        } else if (star != SIZE_MAX) {
+            p = star + 1;
+            n = ++resume;
+        } else {
+            return NME_FALSE;
+        }
+    }
+
+    while (p < pattern_length && pattern[p] == '*') {
+        ++p;
+    }
+
+    return (p == pattern_length);
+}
+
+static int match_glob(char const *pattern, char const *path, int is_directory)
+{
+    NME_ASSERT(pattern != NULL && path != NULL);
+
+    for (;;) {
+        if (*pattern == '\0') {
+            return NME_TRUE;
+        }
+
+        size_t pattern_length = get_segment_length(pattern);
+
+        if (pattern_length == 2 && pattern[0] == '*' && pattern[1] == '*') {
+            char const *rest = pattern + 2 + (pattern[2] != '\0');
+
+            if (is_directory == NME_TRUE) {
+                return NME_TRUE;
+            }
+
+            for (;;) {
+                if (match_glob(rest, path, NME_FALSE) == NME_TRUE) {
+                    return NME_TRUE;
+                }
+
+                if (*path == '\0') {
+                    return NME_FALSE;
+                }
+
+                path += get_segment_length(path);
+                path += (*path != '\0');
+            }
+        }
+
+        if (*path == '\0') {
+            return is_directory;
+        }
+
+        size_t path_length = get_segment_length(path);
+
+        if (match_segment(pattern, pattern_length, path, path_length) ==
+            NME_FALSE) {
+            return NME_FALSE;
+        }
+
+        pattern += pattern_length;
+        pattern += (*pattern != '\0');
+
+        path += path_length;
+        path += (*path != '\0');
+    }
+}
+
+static int is_path_selected(char const *path, int is_directory)
+{
+    NME_ASSERT(path != NULL);
+
+    char const **patterns = (char const **) NME_SELECTION_PATTERNS.data;
+    size_t number_of_patterns = NME_SELECTION_PATTERNS.size /
+        sizeof (char const *);
+
+    if (number_of_patterns == 0) {
+        return NME_TRUE;
+    }
+
+    for (size_t i = 0; i < number_of_patterns; ++i) {
+        if (match_glob(patterns[i], path, is_directory) == NME_TRUE) {
+            return NME_TRUE;
+        }
+    }
+
+    return NME_FALSE;
+}
+
+static int is_entry_selected(arena_t *arena, entry_t const *entry)
+{
+    NME_ASSERT(entry != NULL);
+
+    if (NME_SELECTION_PATTERNS.size == 0) {
+        return NME_TRUE;
+    }
+
+    int is_directory = (entry->type == NME_DIRECTORY ||
+        has_extension(entry->name, "wad") == NME_TRUE);
+
+    arena_mark_t mark = mark_arena(arena);
+
+    char *path = get_archive_path_for_entry(arena, entry, 0);
+    int is_selected = is_path_selected(path, is_directory);
+
+    rewind_arena(arena, mark);
+    return is_selected;
+}
+
+static char *get_path_for_wad(arena_t *arena, wad_t const *wad)
+{
+    NME_ASSERT(wad != NULL);
+    return get_path_for_entry(arena, wad->entry);
+}
+
+static char *get_path_for_image(arena_t *arena, image_t const *image,
+    char const *extension)
+{
+    NME_ASSERT(image != NULL && image->parent != NULL);
+
+    size_t spare = (extension != NULL) ? strlen(extension) + 1 : 0;
+    char *path = join_paths(arena, image->parent->path, image->name, NULL,
+        spare);
+
+    if (extension == NULL) {
+        return path;
+    }
+
+    char *name = path + strlen(path) - strlen(image->name);
+    char *suffix = strrchr(name, '.');
+
+    if (suffix == NULL) {
+        suffix = name + strlen(name);
+    }
+
+    *(suffix++) = '.';
+    strcpy(suffix, extension);
+
+    return path;
+}
+
+static int is_path_separator(char character)
+{
+    return (character == '/' || character == '\\');
+}
+
+static int make_directory(char const *path)
+{
+#if defined (NME_POSIX)
+    int result = mkdir(path, 0777);
+#else
+    int result = _mkdir(path);
+#endif
+
+    return (result == 0 || errno == EEXIST);
+}
+
+static void create_directory(char *path, size_t length)
+{
+    NME_ASSERT(path != NULL && NME_CREATED_DIRECTORIES != NULL);
+
+    if (length == 0 ||
+        find_string(NME_CREATED_DIRECTORIES, path, length) != NULL) {
+        return;
+    }
+
+    for (size_t i = 1; i <= length; ++i) {
+        if (i != length && is_path_separator(path[i]) == NME_FALSE) {
+            continue;
+        }
+
+        if (find_string(NME_CREATED_DIRECTORIES, path, i) != NULL) {
+            continue;
+        }
+
+        char separator = path[i];
+        path[i] = '\0';
+
+        uint64_t start = start_timer();
+        int is_created = make_directory(path);
+
+        stop_timer(&NME_STATISTICS.io_time, start);
+        path[i] = separator;
+
+        if (is_created == NME_FALSE) {
+            report("unable to create directory `%.*s`", (int) i, path);
+            return;
+        }
+
+        insert_string(NME_CREATED_DIRECTORIES, path, i);
+        add_to_statistic(&NME_STATISTICS.directories_created, 1);
+    }
+}
+
+static void create_directory_for_file(char *path)
+{
+    NME_ASSERT(path != NULL);
+
+    if (NME_TAR_STREAM != NULL) {
+        return;
+    }
+
+    size_t length = strlen(path);
+
+    while (length > 0 && is_path_separator(path[length - 1]) == NME_FALSE) {
+        --length;
+    }
+
+    while (length > 0 && is_path_separator(path[length - 1]) == NME_TRUE) {
+        --length;
+    }
+
+    create_directory(path, length);
+}
+
+static void check_file_health(FILE *file)
+{
+    NME_ASSERT(file != NULL);
+
+    if (file == NULL || ferror(file) != 0) {
+        die("invalid or corrupt file");
+    } else if (feof(file) == NME_TRUE) {
+        die("premature end of file");
+    }
+}
+
+static void const *map_file(char const *filename, size_t *size,
+    int64_t *modification_time, int *input_descriptor)
+{
+    NME_ASSERT(filename != NULL && size != NULL);
+
+#if defined (NME_POSIX)
+    int descriptor = open(filename, O_RDONLY);
+    struct stat status;
+
+    if (descriptor == -1) {
+        return NULL;
+    }
+
+    if (fstat(descriptor, &status) != 0 || status.st_size <= 0) {
+        close(descriptor);
+        die("premature end of file");
+    }
+
+    void *data = mmap(NULL, (size_t) status.st_size, PROT_READ, MAP_PRIVATE,
+        descriptor, 0);
+
+    if (input_descriptor != NULL && data != MAP_FAILED) {
+        *input_descriptor = descriptor;
+    } else {
+        close(descriptor);
+    }
+
+    if (data == MAP_FAILED) {
+        die("mmap(%lu) failed", (size_t) status.st_size);
+    }
+
+    *size = (size_t) status.st_size;
+
+    if (modification_time != NULL) {
+        *modification_time = (int64_t) status.st_mtime;
+    }
+
+    return data;
+#else
+    FILE *file = fopen(filename, "rb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (length <= 0) {
+        fclose(file);
+        die("premature end of file");
+    }
+
+    uint8_t *data = allocate((size_t) length);
+
+    if (fread(data, (size_t) length, 1, file) != 1) {
+        fclose(file);
+        release(data);
+
+        die("invalid or corrupt file");
+    }
+
+    fclose(file);
+
+    *size = (size_t) length;
+
+    if (modification_time != NULL) {
+        *modification_time = 0;
+    }
+
+    if (input_descriptor != NULL) {
+        *input_descriptor = -1;
+    }
+
+    return data;
+#endif
+}
+
+static void unmap_file(void const *data, size_t size)
+{
+#if defined (NME_POSIX)
+    if (data != NULL) {
+        munmap((void *) data, size);
+    }
+#else
+    (void) size;
+    release((void *) data);
+#endif
+}
+
+static void map_input_file(archive_t *archive)
+{
+    NME_ASSERT(archive != NULL && archive->filename != NULL);
+    NME_ASSERT(archive->data == NULL);
+
+    archive->data = map_file(archive->filename, &archive->size,
+        &archive->modification_time, &archive->descriptor);
+
+    if (archive->data == NULL) {
+        fail("unable to open `%s`", archive->filename);
+    }
+}
+
+static void unmap_input_file(archive_t *archive)
+{
+    NME_ASSERT(archive != NULL);
+
+    unmap_file(archive->data, archive->size);
+
+#if defined (NME_POSIX)
+    if (archive->descriptor >= 0) {
+        close(archive->descriptor);
+    }
+#endif
+
+    archive->data = NULL;
+    archive->size = 0;
+    archive->descriptor = -1;
+}
+
+static void const *view_input(archive_t const *archive, size_t offset,
+    size_t size)
+{
+    NME_ASSERT(archive != NULL && archive->data != NULL);
+
+    if (offset > archive->size || size > archive->size - offset) {
+        die("premature end of file");
+    }
+
+    return archive->data + offset;
+}
+
+static void const *view_from_input(archive_t const *archive, size_t *cursor,
+    size_t size)
+{
+    NME_ASSERT(cursor != NULL);
+
+    void const *view = view_input(archive, *cursor, size);
+    *cursor += size;
+
+    return view;
+}
+
+static void *read_from_input(archive_t const *archive, void *destination,
+    size_t *cursor, size_t size)
+{
+    if (destination == NULL) {
+        die("invalid or corrupt destination buffer");
+    }
+
+    return memcpy(destination, view_from_input(archive, cursor, size), size);
+}
+
+static void write_into_file(FILE *file, void const *source, size_t size)
+{
+    if (source == NULL) {
+        die("invalid or corrupt source buffer");
+    }
+
+    check_file_health(file);
+    size_t count = fwrite(source, size, 1, file);
+
+    if (count != 1) {
+        report("write_into_file(%p, %lu) failed", source, size);
+    }
+}
+
+#if defined (NME_POSIX)
+static int open_directory(atomic_int *directory, char const *filename)
+{
+    NME_ASSERT(directory != NULL && filename != NULL);
+
+    int descriptor = atomic_load(directory);
+
+    if (descriptor != NME_UNOPENED_DESCRIPTOR) {
+        return descriptor;
+    }
+
+    descriptor = -1;
+
+    if (atomic_fetch_add(&NME_NUMBER_OF_OPEN_DIRECTORIES, 1) <
+        NME_MAXIMUM_OPEN_DIRECTORIES) {
+        size_t length = strrchr(filename, NME_PATH_SEPARATOR) - filename;
+        char *path = allocate_uninitialized(length + 1);
+
+        memcpy(path, filename, length);
+        path[length] = '\0';
+
+        descriptor = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        release(path);
+    }
+
+    int expected = NME_UNOPENED_DESCRIPTOR;
+
+    if (descriptor == -1) {
+        atomic_fetch_sub(&NME_NUMBER_OF_OPEN_DIRECTORIES, 1);
+        atomic_compare_exchange_strong(directory, &expected, -1);
+
+        return atomic_load(directory);
+    }
+
+    if (atomic_compare_exchange_strong(directory, &expected,
+        descriptor) == NME_FALSE) {
+        atomic_fetch_sub(&NME_NUMBER_OF_OPEN_DIRECTORIES, 1);
+        close(descriptor);
+
+        return expected;
+    }
+
+    return descriptor;
+}
+
+static void close_directory(atomic_int *directory)
+{
+    NME_ASSERT(directory != NULL);
+
+    int descriptor = atomic_load(directory);
+
+    if (descriptor >= 0) {
+        close(descriptor);
+        atomic_fetch_sub(&NME_NUMBER_OF_OPEN_DIRECTORIES, 1);
+    }
+
+    atomic_store(directory, NME_UNOPENED_DESCRIPTOR);
+}
+#endif
+
+#if defined (NME_POSIX)
+static int open_descriptor_at(atomic_int *directory, char const *name,
+    char const *filename)
+{
+    NME_ASSERT(filename != NULL);
+
+    int const flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+    if (NME_USE_OPENAT == NME_TRUE && directory != NULL && name != NULL &&
+        strchr(filename, NME_PATH_SEPARATOR) != NULL) {
+        int descriptor = open_directory(directory, filename);
+
+        if (descriptor != -1) {
+            descriptor = openat(descriptor, name, flags, 0666);
+        }
+
+        if (descriptor != -1) {
+            return descriptor;
+        }
+    }
+
+    return open(filename, flags, 0666);
+}
+#endif
+
+static FILE *open_file_at(atomic_int *directory, char const *name,
+    char const *filename)
+{
+    NME_ASSERT(filename != NULL);
+
+#if defined (NME_POSIX)
+    if (NME_USE_OPENAT == NME_TRUE) {
+        int descriptor = open_descriptor_at(directory, name, filename);
+
+        if (descriptor != -1) {
+            FILE *file = fdopen(descriptor, "wb");
+
+            if (file != NULL) {
+                return file;
+            }
+
+            close(descriptor);
+        }
+    }
+#else
+    (void) directory;
+    (void) name;
+#endif
+
+    return fopen(filename, "wb");
+}
+
+#if defined (NME_POSIX)
+static int write_in_chunks(int output, uint8_t const *data, size_t size)
+{
+    for (size_t written = 0; written < size;) {
+        size_t chunk = size - written;
+
+        if (chunk > NME_COPY_CHUNK_SIZE) {
+            chunk = NME_COPY_CHUNK_SIZE;
+        }
+
+        ssize_t count = write(output, data + written, chunk);
+
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (count <= 0) {
+            return NME_FALSE;
+        }
+
+        written += (size_t) count;
+    }
+
+    return NME_TRUE;
+}
+
+static void record_write_failure(writer_t *writer, write_job_t *job)
+{
+    job->has_failed = NME_TRUE;
+    atomic_fetch_add(&NME_STATISTICS.files_skipped, 1);
+
+    lock_mutex(&writer->mutex);
+
+    if (writer->number_of_failures++ == 0) {
+        size_t const length = strlen(job->filename) + 1;
+        writer->first_failure = memcpy(allocate(length), job->filename,
+            length);
+    }
+
+    unlock_mutex(&writer->mutex);
+}
+
+static void finish_write_job(writer_t *writer, write_job_t *job)
+{
+    if (job->has_failed == NME_FALSE) {
+        add_to_statistic(&NME_STATISTICS.files_written, 1);
+        add_to_statistic(&NME_STATISTICS.bytes_written, job->size);
+    }
+
+    lock_mutex(&writer->mutex);
+
+    writer->backlog -= job->footprint;
+    broadcast_condition(&writer->condition);
+
+    unlock_mutex(&writer->mutex);
+    release(job);
+}
+
+static write_job_t *take_write_jobs(writer_t *writer, size_t maximum,
+    int is_idle)
+{
+    lock_mutex(&writer->mutex);
+
+    while (is_idle == NME_TRUE && writer->first == NULL &&
+        writer->is_closing == NME_FALSE) {
+        wait_for_condition(&writer->condition, &writer->mutex);
+    }
+
+    write_job_t *jobs = writer->first;
+    write_job_t *last = NULL;
+
+    for (size_t i = 0; i < maximum && writer->first != NULL; ++i) {
+        last = writer->first;
+        writer->first = last->next;
+    }
+
+    if (last != NULL) {
+        last->next = NULL;
+    } else {
+        jobs = NULL;
+    }
+
+    if (writer->first == NULL) {
+        writer->last = NULL;
+    }
+
+    unlock_mutex(&writer->mutex);
+    return jobs;
+}
+
+static void *run_writer_thread(void *context)
+{
+    writer_t *writer = context;
+
+    for (;;) {
+        write_job_t *job = take_write_jobs(writer, 1, NME_TRUE);
+
+        if (job == NULL) {
+            return NULL;
+        }
+
+        int output = open_descriptor_at(NULL, NULL, job->filename);
+
+        if (output == -1) {
+            record_write_failure(writer, job);
+        } else {
+            if (write_in_chunks(output, job->data, job->size) == NME_FALSE) {
+                record_write_failure(writer, job);
+            }
+
+            close(output);
+        }
+
+        finish_write_job(writer, job);
+    }
+}
+
+#if defined (NME_IO_URING)
+static void *map_ring(ring_t *ring, size_t size, off_t offset)
+{
+    void *data = mmap(NULL, size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring->descriptor, offset);
+
+    return (data == MAP_FAILED) ? NULL : data;
+}
+
+static int is_ring_operation_supported(int descriptor)
+{
+    size_t const size = sizeof (struct io_uring_probe) +
+        sizeof (struct io_uring_probe_op) * 256;
+
+    struct io_uring_probe *probe = allocate(size);
+
+    int is_supported = (syscall(__NR_io_uring_register, descriptor,
+        IORING_REGISTER_PROBE, probe, 256) == 0 &&
+        probe->last_op >= IORING_OP_WRITE &&
+        (probe->ops[IORING_OP_OPENAT].flags & IO_URING_OP_SUPPORTED) != 0 &&
+        (probe->ops[IORING_OP_CLOSE].flags & IO_URING_OP_SUPPORTED) != 0 &&
+        (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED) != 0);
+
+    release(probe);
+    return is_supported;
+}
+
+static void free_ring(ring_t *ring)
+{
+    if (ring == NULL) {
+        return;
+    }
+
+    if (ring->entries != NULL) {
+        munmap(ring->entries, ring->entries_size);
+    }
+
+    if (ring->completions != NULL && ring->completions != ring->submissions) {
+        munmap(ring->completions, ring->completions_size);
+    }
+
+    if (ring->submissions != NULL) {
+        munmap(ring->submissions, ring->submissions_size);
+    }
+
+    close(ring->descriptor);
+    release(ring);
+}
+
+static ring_t *create_ring(unsigned number_of_entries)
+{
+    struct io_uring_params parameters;
+    memset(&parameters, 0x00, sizeof (struct io_uring_params));
+
+    int descriptor = (int) syscall(__NR_io_uring_setup, number_of_entries,
+        &parameters);
+
+    if (descriptor < 0) {
+        return NULL;
+    }
+
+    ring_t *ring = allocate(sizeof (ring_t));
+    ring->descriptor = descriptor;
+
+    if (is_ring_operation_supported(descriptor) == NME_FALSE ||
+        (parameters.features & IORING_FEAT_NODROP) == 0) {
+        free_ring(ring);
+        return NULL;
+    }
+
+    ring->submissions_size = parameters.sq_off.array +
+        parameters.sq_entries * sizeof (unsigned);
+    ring->completions_size = parameters.cq_off.cqes +
+        parameters.cq_entries * sizeof (struct io_uring_cqe);
+
+    if ((parameters.features & IORING_FEAT_SINGLE_MMAP) != 0 &&
+        ring->completions_size > ring->submissions_size) {
+        ring->submissions_size = ring->completions_size;
+    }
+
+    ring->entries_size = parameters.sq_entries * sizeof (struct io_uring_sqe);
+
+    ring->submissions = map_ring(ring, ring->submissions_size,
+        IORING_OFF_SQ_RING);
+
+    if ((parameters.features & IORING_FEAT_SINGLE_MMAP) != 0) {
+        ring->completions = ring->submissions;
+    } else {
+        ring->completions = map_ring(ring, ring->completions_size,
+            IORING_OFF_CQ_RING);
+    }
+
+    ring->entries = map_ring(ring, ring->entries_size, IORING_OFF_SQES);
+
+    if (ring->submissions == NULL || ring->completions == NULL ||
+        ring->entries == NULL) {
+        free_ring(ring);
+        return NULL;
+    }
+
+    uint8_t *submissions = ring->submissions;
+    uint8_t *completions = ring->completions;
+
+    ring->submission_head = (atomic_uint *) (submissions +
+        parameters.sq_off.head);
+    ring->submission_tail = (atomic_uint *) (submissions +
+        parameters.sq_off.tail);
+    ring->submission_mask = *(unsigned *) (submissions +
+        parameters.sq_off.ring_mask);
+    ring->submission_array = (unsigned *) (submissions +
+        parameters.sq_off.array);
+
+    ring->completion_head = (atomic_uint *) (completions +
+        parameters.cq_off.head);
+    ring->completion_tail = (atomic_uint *) (completions +
+        parameters.cq_off.tail);
+    ring->completion_mask = *(unsigned *) (completions +
+        parameters.cq_off.ring_mask);
+    ring->completion_entries = (struct io_uring_cqe *) (completions +
+        parameters.cq_off.cqes);
+
+    ring->capacity = parameters.sq_entries;
+    return ring;
+}
+
+static struct io_uring_sqe *prepare_ring_entry(ring_t *ring,
+    write_job_t *job, uint8_t operation)
+{
+    unsigned tail = atomic_load_explicit(ring->submission_tail,
+        memory_order_relaxed);
+    unsigned index = tail & ring->submission_mask;
+
+    struct io_uring_sqe *entry = &((struct io_uring_sqe *)
+        ring->entries)[index];
+
+    memset(entry, 0x00, sizeof (struct io_uring_sqe));
+
+    entry->opcode = operation;
+    entry->fd = job->descriptor;
+    entry->user_data = (uint64_t) (uintptr_t) job;
+
+    ring->submission_array[index] = index;
+    atomic_store_explicit(ring->submission_tail, tail + 1,
+        memory_order_release);
+
+    ++ring->unsubmitted;
+    return entry;
+}
+
+static void queue_ring_open(ring_t *ring, write_job_t *job)
+{
+    job->descriptor = AT_FDCWD;
+
+    struct io_uring_sqe *entry = prepare_ring_entry(ring, job,
+        IORING_OP_OPENAT);
+
+    entry->addr = (uint64_t) (uintptr_t) job->filename;
+    entry->len = 0666;
+    entry->open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+}
+
+static void queue_ring_write(ring_t *ring, write_job_t *job)
+{
+    size_t chunk = job->size - job->written;
+
+    if (chunk > NME_COPY_CHUNK_SIZE) {
+        chunk = NME_COPY_CHUNK_SIZE;
+    }
+
+    struct io_uring_sqe *entry = prepare_ring_entry(ring, job,
+        IORING_OP_WRITE);
+
+    entry->addr = (uint64_t) (uintptr_t) (job->data + job->written);
+    entry->len = (uint32_t) chunk;
+    entry->off = job->written;
+}
+
+static void queue_ring_close(ring_t *ring, write_job_t *job)
+{
+    prepare_ring_entry(ring, job, IORING_OP_CLOSE);
+}
+
+static int complete_ring_entry(writer_t *writer, write_job_t *job,
+    int result)
+{
+    ring_t *ring = writer->ring;
+
+    switch (job->state) {
+    case NME_WRITE_JOB_OPENING:
+        if (result < 0) {
+            record_write_failure(writer, job);
+            return NME_TRUE;
+        }
+
+        job->descriptor = result;
+        job->state = NME_WRITE_JOB_WRITING;
+
+        if (job->size != 0) {
+            queue_ring_write(ring, job);
+            return NME_FALSE;
+        }
+
+        break;
+
+    case NME_WRITE_JOB_WRITING:
+        if (result == -EINTR || result == -EAGAIN) {
+            queue_ring_write(ring, job);
+            return NME_FALSE;
+        }
+
+        if (result <= 0) {
+            record_write_failure(writer, job);
+            break;
+        }
+
+        job->written += (size_t) result;
+
+        if (job->written < job->size) {
+            queue_ring_write(ring, job);
+            return NME_FALSE;
+        }
+
+        break;
+
+    default:
+        return NME_TRUE;
+    }
+
+    job->state = NME_WRITE_JOB_CLOSING;
+    queue_ring_close(ring, job);
+
+    return NME_FALSE;
+}
+
+static void *run_ring_thread(void *context)
+{
+    writer_t *writer = context;
+    ring_t *ring = writer->ring;
+
+    size_t active = 0;
+
+    for (;;) {
+        write_job_t *jobs = take_write_jobs(writer, ring->capacity - active,
+            (active == 0) ? NME_TRUE : NME_FALSE);
+
+        if (jobs == NULL && active == 0) {
+            return NULL;
+        }
+
+        for (write_job_t *job = jobs; job != NULL; job = job->next) {
+            job->state = NME_WRITE_JOB_OPENING;
+            queue_ring_open(ring, job);
+
+            ++active;
+        }
+
+        long count = syscall(__NR_io_uring_enter, ring->descriptor,
+            ring->unsubmitted, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+        if (count < 0 && errno != EINTR && errno != EBUSY) {
+            die("io_uring_enter() failed");
+        }
+
+        if (count > 0) {
+            ring->unsubmitted -= (unsigned) count;
+        }
+
+        unsigned head = atomic_load_explicit(ring->completion_head,
+            memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(ring->completion_tail,
+            memory_order_acquire);
+
+        for (; head != tail; ++head) {
+            struct io_uring_cqe const *completion =
+                &ring->completion_entries[head & ring->completion_mask];
+            write_job_t *job = (write_job_t *) (uintptr_t)
+                completion->user_data;
+
+            if (complete_ring_entry(writer, job,
+                completion->res) == NME_TRUE) {
+                finish_write_job(writer, job);
+                --active;
+            }
+        }
+
+        atomic_store_explicit(ring->completion_head, head,
+            memory_order_release);
+    }
+}
+#endif
+
+static writer_t *create_writer(int is_ring_allowed)
+{
+    writer_t *writer = allocate(sizeof (writer_t));
+
+    create_mutex(&writer->mutex);
+    create_condition(&writer->condition);
+
+    void *(*function)(void *) = run_writer_thread;
+    char const *backend = "writer threads";
+
+    writer->number_of_threads = NME_NUMBER_OF_WRITER_THREADS;
+    writer->maximum_backlog = NME_WRITER_BACKLOG;
+
+    if (NME_MEMORY_LIMIT != 0 && NME_MEMORY_LIMIT < NME_WRITER_BACKLOG) {
+        writer->maximum_backlog = NME_MEMORY_LIMIT;
+    }
+
+#if defined (NME_IO_URING)
+    if (is_ring_allowed == NME_TRUE) {
+        writer->ring = create_ring(NME_RING_CAPACITY);
+    }
+
+    if (writer->ring != NULL) {
+        function = run_ring_thread;
+        backend = "io_uring";
+
+        writer->number_of_threads = 1;
+    }
+#else
+    (void) is_ring_allowed;
+#endif
+
+    writer->threads = allocate(sizeof (pthread_t) *
+        writer->number_of_threads);
+
+    for (size_t i = 0; i < writer->number_of_threads; ++i) {
+        if (pthread_create(&writer->threads[i], NULL, function,
+            writer) != 0) {
+            die("pthread_create() failed");
+        }
+    }
+
+    if (NME_VERBOSITY != NME_SILENT) {
+        report("writing outputs with %s", backend);
+    }
+
+    return writer;
+}
+
+static void queue_write(writer_t *writer, char const *filename,
+    void const *data, size_t size, int is_borrowed)
+{
+    NME_ASSERT(writer != NULL && filename != NULL);
+
+    size_t const length = strlen(filename) + 1;
+    size_t footprint = sizeof (write_job_t) + length;
+
+    if (is_borrowed == NME_FALSE) {
+        footprint += size;
+    }
+
+    write_job_t *job = allocate_uninitialized(footprint);
+    memset(job, 0x00, sizeof (write_job_t));
+
+    char *copy = (char *) (job + 1);
+
+    job->filename = memcpy(copy, filename, length);
+    job->data = data;
+    job->size = size;
+    job->footprint = footprint;
+
+    if (is_borrowed == NME_FALSE && size != 0) {
+        job->data = memcpy(copy + length, data, size);
+    }
+
+    lock_mutex(&writer->mutex);
+
+    while (writer->backlog != 0 &&
+        writer->backlog + footprint > writer->maximum_backlog) {
+        wait_for_condition(&writer->condition, &writer->mutex);
+    }
+
+    if (writer->last != NULL) {
+        writer->last->next = job;
+    } else {
+        writer->first = job;
+    }
+
+    writer->last = job;
+    writer->backlog += footprint;
+
+    broadcast_condition(&writer->condition);
+    unlock_mutex(&writer->mutex);
+}
+
+static void close_writer(writer_t *writer)
+{
+    if (writer == NULL) {
+        return;
+    }
+
+    lock_mutex(&writer->mutex);
+
+    writer->is_closing = NME_TRUE;
+    broadcast_condition(&writer->condition);
+
+    unlock_mutex(&writer->mutex);
+
+    for (size_t i = 0; i < writer->number_of_threads; ++i) {
+        pthread_join(writer->threads[i], NULL);
+    }
+
+    if (writer->number_of_failures != 0) {
+        report("unable to write `%s`, %zu outputs were skipped",
+            writer->first_failure, writer->number_of_failures);
+    }
+
+#if defined (NME_IO_URING)
+    free_ring(writer->ring);
+#endif
+
+    free_condition(&writer->condition);
+    free_mutex(&writer->mutex);
+
+    release(writer->first_failure);
+    release(writer->threads);
+    release(writer);
+}
+#else
+static writer_t *create_writer(int is_ring_allowed)
+{
+    (void) is_ring_allowed;
+
+    fail("option `--async-io` is not supported on this platform");
+    return NULL;
+}
+
+static void queue_write(writer_t *writer, char const *filename,
+    void const *data, size_t size, int is_borrowed)
+{
+    (void) writer;
+    (void) filename;
+    (void) data;
+    (void) size;
+    (void) is_borrowed;
+}
+
+static void close_writer(writer_t *writer)
+{
+    (void) writer;
+}
+#endif
+
+static tar_stream_t *open_tar_stream(char const *filename)
+{
+    NME_ASSERT(filename != NULL);
+
+    tar_stream_t *stream = allocate(sizeof (tar_stream_t));
+
+    stream->file = (strcmp(filename, "-") == 0) ? stdout :
+        fopen(filename, "wb");
+
+    if (stream->file == NULL) {
+        die("unable to open `%s`", filename);
+    }
+
+    setvbuf(stream->file, NULL, _IOFBF, NME_COPY_CHUNK_SIZE);
+
+    stream->modification_time = (int64_t) time(NULL);
+    create_mutex(&stream->mutex);
+
+    return stream;
+}
+
+static void close_tar_stream(tar_stream_t *stream)
+{
+    if (stream == NULL) {
+        return;
+    }
+
+    static uint8_t const trailer[2 * NME_TAR_BLOCK_SIZE] = { 0 };
+    fwrite(trailer, sizeof (trailer), 1, stream->file);
+
+    if (fflush(stream->file) != 0 || ferror(stream->file) != 0) {
+        die("unable to write the tar stream");
+    }
+
+    if (stream->file != stdout) {
+        fclose(stream->file);
+    }
+
+    free_mutex(&stream->mutex);
+    release(stream);
+}
+
+static void write_tar_block_locked(tar_stream_t *stream, char const *name,
+    size_t name_length, char const *prefix, size_t prefix_length,
+    size_t size, char type)
+{
+    uint8_t header[NME_TAR_BLOCK_SIZE];
+    memset(header, 0x00, sizeof (header));
+
+    memcpy(header, name, name_length);
+    memcpy(header + 345, prefix, prefix_length);
+
+    snprintf((char *) header + 100, 8, "%07o", 0644);
+    snprintf((char *) header + 108, 8, "%07o", 0);
+    snprintf((char *) header + 116, 8, "%07o", 0);
+
+    snprintf((char *) header + 124, 12, "%011llo", (unsigned long long) size);
+    snprintf((char *) header + 136, 12, "%011llo",
+        (unsigned long long) stream->modification_time);
+
+    header[156] = (uint8_t) type;
+
+    memcpy(header + 257, "ustar", 6);
+    memcpy(header + 263, "00", 2);
+
+    memset(header + 148, ' ', 8);
+    uint32_t checksum = 0;
+
+    for (size_t i = 0; i < sizeof (header); ++i) {
+        checksum += header[i];
+    }
+
+    snprintf((char *) header + 148, 7, "%06o", checksum);
+    fwrite(header, sizeof (header), 1, stream->file);
+}
+
+static void write_tar_data_locked(tar_stream_t *stream, void const *data,
+    size_t size)
+{
+    static uint8_t const padding[NME_TAR_BLOCK_SIZE] = { 0 };
+
+    if (data != NULL && size != 0) {
+        fwrite(data, size, 1, stream->file);
+    }
+
+    fwrite(padding, (NME_TAR_BLOCK_SIZE - size % NME_TAR_BLOCK_SIZE) %
+        NME_TAR_BLOCK_SIZE, 1, stream->file);
+}
+
+static void write_tar_record(char const *path, void const *contents,
+    size_t size)
+{
+    NME_ASSERT(path != NULL && NME_TAR_STREAM != NULL);
+
+    tar_stream_t *stream = NME_TAR_STREAM;
+    size_t const length = strlen(path);
+
+    size_t split = 0;
+
+    int is_split = (length > NME_TAR_NAME_LENGTH);
+    int is_extended = NME_FALSE;
+
+    if (is_split == NME_TRUE) {
+        split = length - NME_TAR_NAME_LENGTH - 1;
+
+        while (split < length && is_path_separator(path[split]) == NME_FALSE) {
+            ++split;
+        }
+
+        is_extended = (split >= length || split > NME_TAR_PREFIX_LENGTH);
+    }
+
+    char record[32];
+    size_t record_length = 0;
+
+    if (is_extended == NME_TRUE) {
+        size_t digits = 1;
+
+        while (snprintf(record, sizeof (record), "%zu",
+            digits + length + 7) != (int) digits) {
+            ++digits;
+        }
+
+        record_length = digits + length + 7;
+    }
+
+    uint64_t start = start_timer();
+    lock_mutex(&stream->mutex);
+
+    if (is_extended == NME_TRUE) {
+        write_tar_block_locked(stream, "././@PaxHeader", 14, "", 0,
+            record_length, 'x');
+
+        fprintf(stream->file, "%zu path=%s\n", record_length, path);
+        write_tar_data_locked(stream, NULL, record_length);
+
+        write_tar_block_locked(stream, path, NME_TAR_NAME_LENGTH, "", 0,
+            size, '0');
+    } else if (is_split == NME_TRUE) {
+        write_tar_block_locked(stream, path + split + 1,
+            length - split - 1, path, split, size, '0');
+    } else {
+        write_tar_block_locked(stream, path, length, "", 0, size, '0');
+    }
+
+    write_tar_data_locked(stream, contents, size);
+    unlock_mutex(&stream->mutex);
+
+    stop_timer(&NME_STATISTICS.io_time, start);
+}
+
+static void write_to_file_at(atomic_int *directory, char const *name,
+    char const *filename, void const *contents, size_t size)
+{
+    NME_ASSERT(filename != NULL);
+
+    uint64_t start = start_timer();
+    FILE *file = open_file_at(directory, name, filename);
+
+    check_file_health(file);
+    write_into_file(file, contents, size);
+
+    fclose(file);
+    stop_timer(&NME_STATISTICS.io_time, start);
+
+    add_to_statistic(&NME_STATISTICS.files_written, 1);
+    add_to_statistic(&NME_STATISTICS.bytes_written, size);
+}
+
+static void dump_to_file_at(atomic_int *directory, char const *name,
+    char const *filename, void const *contents, size_t size)
+{
+    if (NME_WRITER != NULL) {
+        queue_write(NME_WRITER, filename, contents, size, NME_FALSE);
+        return;
+    }
+
+    if (NME_TAR_STREAM == NULL) {
+        write_to_file_at(directory, name, filename, contents, size);
+        return;
+    }
+
+    write_tar_record(filename, contents, size);
+
+    add_to_statistic(&NME_STATISTICS.files_written, 1);
+    add_to_statistic(&NME_STATISTICS.bytes_written, size);
+}
+
+static void dump_to_file(char const *filename, void const *contents,
+    size_t size)
+{
+    write_to_file_at(NULL, NULL, filename, contents, size);
+}
+
+#if defined (NME_POSIX)
+static size_t copy_with_kernel(int output, int input, size_t offset,
+    size_t size)
+{
+    size_t copied = 0;
+
+#if defined (NME_KERNEL_COPY)
+    loff_t input_offset = (loff_t) offset;
+
+    while (copied < size) {
+        ssize_t count = copy_file_range(input, &input_offset, output, NULL,
+            size - copied, 0);
+
+        if (count <= 0) {
+            break;
+        }
+
+        copied += (size_t) count;
+    }
+
+    off_t sent_offset = (off_t) (offset + copied);
+
+    while (copied < size) {
+        ssize_t count = sendfile(output, input, &sent_offset, size - copied);
+
+        if (count <= 0) {
+            break;
+        }
+
+        copied += (size_t) count;
+    }
+#else
+    (void) output;
+    (void) input;
+    (void) offset;
+    (void) size;
+#endif
+
+    return copied;
+}
+
+static void copy_to_file_at(atomic_int *directory, char const *name,
+    char const *filename, archive_t const *archive, size_t offset,
+    size_t size)
+{
+    NME_ASSERT(filename != NULL && archive != NULL);
+
+    uint8_t const *data = view_input(archive, offset, size);
+
+    uint64_t start = start_timer();
+    int output = open_descriptor_at(directory, name, filename);
+
+    if (output == -1) {
+        die("unable to open `%s`", filename);
+    }
+
+#if defined (NME_KERNEL_COPY)
+    if (size >= NME_PREALLOCATION_THRESHOLD) {
+        fallocate(output, 0, 0, (off_t) size);
+    }
+#endif
+
+    size_t copied = copy_with_kernel(output, archive->descriptor, offset,
+        size);
+
+    if (copied < size &&
+        write_in_chunks(output, data + copied, size - copied) == NME_FALSE) {
+        report("unable to write `%s`", filename);
+    }
+
+    close(output);
+    stop_timer(&NME_STATISTICS.io_time, start);
+
+    add_to_statistic(&NME_STATISTICS.files_written, 1);
+    add_to_statistic(&NME_STATISTICS.bytes_written, size);
+}
+#endif
+
+static void extract_file_subsection(entry_t const *entry,
+    char const *filename)
+{
+    NME_ASSERT(entry != NULL);
+
+    archive_t const *archive = entry->parent->archive;
+    add_to_statistic(&NME_STATISTICS.bytes_read, entry->size);
+
+    if (NME_WRITER != NULL) {
+        queue_write(NME_WRITER, filename, view_input(archive, entry->offset,
+            entry->size), entry->size, NME_TRUE);
+
+        return;
+    }
+
+#if defined (NME_POSIX)
+    if (archive->descriptor >= 0 && NME_TAR_STREAM == NULL) {
+        copy_to_file_at(&entry->parent->descriptor, entry->name, filename,
+            archive, entry->offset, entry->size);
+
+        return;
+    }
+#endif
+
+    dump_to_file_at(&entry->parent->descriptor, entry->name, filename,
+        view_input(archive, entry->offset, entry->size), entry->size);
+}
+
+static image_t *read_image_information(archive_t const *archive,
+    image_t *image, size_t *cursor)
+{
+    NME_ASSERT(image != NULL);
+
+    size_t const non_header_data_size = sizeof (uint8_t const *) +
+        sizeof (uint32_t) + sizeof (line_offsets_t) + sizeof (wad_t const *);
+
+    read_from_input(archive, image, cursor,
+        sizeof (image_t) - non_header_data_size);
+    image->name[31] = '\0';
+
+    view_from_input(archive, cursor, 6);
+
+    return image;
+}
+
+static image_t *read_image_pixel_data(archive_t const *archive,
+    image_t *image, size_t *cursor)
+{
+    NME_ASSERT(image != NULL);
+
+    if (image->pixel_data_size > archive->size) {
+        die("premature end of file");
+    }
+
+    image->pixel_data = view_from_input(archive, cursor,
+        image->pixel_data_size);
+    return image;
+}
+
+static image_t *read_image_line_offsets(archive_t const *archive,
+    image_t *image, size_t *cursor)
+{
+    NME_ASSERT(image != NULL);
+
+    size_t const non_header_data_size = sizeof (uint32_t const *);
+
+    read_from_input(archive, &image->line_offsets, cursor,
+        sizeof (line_offsets_t) - non_header_data_size);
+
+    if (image->height == 0) {
+        return image;
+    }
+
+    image->line_offsets.values = view_from_input(archive, cursor,
+        sizeof (uint32_t) * image->height);
+
+    return image;
+}
+
+static uint32_t reverse_bits(uint32_t code, size_t length)
+{
+    uint32_t reversed = 0;
+
+    for (size_t i = 0; i < length; ++i, code >>= 1) {
+        reversed = (reversed << 1) | (code & 1);
+    }
+
+    return reversed;
+}
+
+static void create_encoder_tables(void)
+{
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+
+        for (size_t k = 0; k < 8; ++k) {
+            crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+        }
+
+        NME_CRC_TABLE[i] = crc;
+    }
+
+    for (uint32_t i = 0; i < 288; ++i) {
+        uint32_t code = 0x30 + i;
+        size_t length = 8;
+
+        if (i >= 144 && i < 256) {
+            code = 0x190 + (i - 144);
+            length = 9;
+        } else if (i >= 256 && i < 280) {
+            code = i - 256;
+            length = 7;
+        } else if (i >= 280) {
+            code = 0xC0 + (i - 280);
+        }
+
+        NME_FIXED_LITERAL_CODES[i] = (uint16_t) reverse_bits(code, length);
+        NME_FIXED_LITERAL_LENGTHS[i] = (uint8_t) length;
+    }
+
+    for (size_t length = 3, symbol = 0; length <= 258; ++length) {
+        while (symbol + 1 < 29 && NME_LENGTH_BASES[symbol + 1] <= length) {
+            ++symbol;
+        }
+
+        NME_LENGTH_SYMBOLS[length] = (uint8_t) symbol;
+    }
+}
+
+static void write_big_endian(uint8_t *destination, uint32_t value)
+{
+    destination[0] = (uint8_t) (value >> 24);
+    destination[1] = (uint8_t) (value >> 16);
+    destination[2] = (uint8_t) (value >> 8);
+    destination[3] = (uint8_t) value;
+}
+
+static uint32_t compute_crc(uint32_t crc, uint8_t const *data, size_t size)
+{
+    crc = ~crc;
+
+    for (size_t i = 0; i < size; ++i) {
+        crc = NME_CRC_TABLE[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+static uint32_t compute_adler(uint8_t const *data, size_t size)
+{
+    uint32_t a = 1;
+    uint32_t b = 0;
+
+    while (size != 0) {
+        size_t count = (size < 5552) ? size : 5552;
+        size -= count;
+
+        for (; count != 0; --count) {
+            a += *(data++);
+            b += a;
+        }
+
+        a %= 65521;
+        b %= 65521;
+    }
+
+    return (b << 16) | a;
+}
+
+static void write_bits(bit_stream_t *stream, uint32_t value, size_t count)
+{
+    stream->bits |= (uint64_t) value << stream->count;
+    stream->count += (unsigned) count;
+
+    while (stream->count >= 8) {
+        *(stream->cursor++) = (uint8_t) stream->bits;
+
+        stream->bits >>= 8;
+        stream->count -= 8;
+    }
+}
+
+static void write_fixed_literal(bit_stream_t *stream, size_t symbol)
+{
+    write_bits(stream, NME_FIXED_LITERAL_CODES[symbol],
+        NME_FIXED_LITERAL_LENGTHS[symbol]);
+}
+
+static size_t get_distance_symbol(size_t distance)
+{
+    size_t symbol = 0;
+
+    while (symbol + 1 < 30 && NME_DISTANCE_BASES[symbol + 1] <= distance) {
+        ++symbol;
+    }
+
+    return symbol;
+}
+
+static void deflate_stored(buffer_t *output, uint8_t const *data, size_t size)
+{
+    do {
+        size_t length = (size < NME_MAXIMUM_STORED_BLOCK_SIZE) ? size :
+            NME_MAXIMUM_STORED_BLOCK_SIZE;
+
+        uint8_t const header[5] = {
+            length == size, (uint8_t) length, (uint8_t) (length >> 8),
+            (uint8_t) ~length, (uint8_t) (~length >> 8)
+        };
+
+        append_to_buffer(output, header, sizeof (header));
+        append_to_buffer(output, data, length);
+
+        data += length;
+        size -= length;
+    } while (size != 0);
+}
+
+static void deflate_fixed(buffer_t *output, uint8_t const *data, size_t size,
+    size_t channels, size_t stride)
+{
+    size_t const distances[2] = {
+        channels, (stride <= NME_MAXIMUM_MATCH_DISTANCE) ? stride : 0
+    };
+
+    size_t const symbols[2] = {
+        get_distance_symbol(distances[0]), get_distance_symbol(distances[1])
+    };
+
+    size_t offset = output->size;
+    append_to_buffer(output, NULL, size + size / 8 + 16);
+
+    bit_stream_t stream = { output->data + offset, 0, 0 };
+
+    write_bits(&stream, 1, 1);
+    write_bits(&stream, 1, 2);
+
+    for (size_t i = 0; i < size;) {
+        size_t limit = size - i;
+
+        if (limit > NME_MAXIMUM_MATCH_LENGTH) {
+            limit = NME_MAXIMUM_MATCH_LENGTH;
+        }
+
+        size_t best_length = 0;
+        size_t best = 0;
+
+        for (size_t k = 0; k < 2; ++k) {
+            size_t distance = distances[k];
+
+            if (distance == 0 || distance > i) {
+                continue;
+            }
+
+            size_t length = 0;
+
+            while (length < limit &&
+                data[i + length] == data[i + length - distance]) {
+                ++length;
+            }
+
+            if (length > best_length) {
+                best_length = length;
+                best = k;
+            }
+        }
+
+        if (best_length < 3) {
+            write_fixed_literal(&stream, data[i++]);
+            continue;
+        }
+
+        size_t symbol = NME_LENGTH_SYMBOLS[best_length];
+
+        write_fixed_literal(&stream, 257 + symbol);
+        write_bits(&stream, (uint32_t) (best_length -
+            NME_LENGTH_BASES[symbol]), NME_LENGTH_EXTRA_BITS[symbol]);
+
+        symbol = symbols[best];
+
+        write_bits(&stream, reverse_bits((uint32_t) symbol, 5), 5);
+        write_bits(&stream, (uint32_t) (distances[best] -
+            NME_DISTANCE_BASES[symbol]), NME_DISTANCE_EXTRA_BITS[symbol]);
+
+        i += best_length;
+    }
+
+    write_fixed_literal(&stream, 256);
+    write_bits(&stream, 0, (8 - stream.count) & 7);
+
+    output->size = stream.cursor - output->data;
+}
+
+static size_t begin_png_chunk(buffer_t *output, char const *type)
+{
+    size_t offset = output->size;
+
+    append_to_buffer(output, NULL, 4);
+    append_to_buffer(output, type, 4);
+
+    return offset;
+}
+
+static void end_png_chunk(buffer_t *output, size_t offset)
+{
+    uint8_t *chunk = output->data + offset;
+    size_t length = output->size - offset - 8;
+
+    uint8_t crc[4];
+
+    write_big_endian(chunk, (uint32_t) length);
+    write_big_endian(crc, compute_crc(0, chunk + 4, length + 4));
+
+    append_to_buffer(output, crc, sizeof (crc));
+}
+
+static void write_png_chunk(buffer_t *output, char const *type,
+    void const *data, size_t size)
+{
+    size_t offset = begin_png_chunk(output, type);
+
+    if (size != 0) {
+        append_to_buffer(output, data, size);
+    }
+
+    end_png_chunk(output, offset);
+}
+
+static void write_to_buffer(void *context, void *data, int size)
+{
+    append_to_buffer(context, data, (size_t) size);
+}
+
+static int encode_bmp(buffer_t *output, buffer_t *scratch,
+    uint8_t const *pixel_data, size_t width, size_t height, size_t channels)
+{
+    (void) scratch;
+
+    return stbi_write_bmp_to_func(write_to_buffer, output, (int) width,
+        (int) height, (int) channels, pixel_data) != 0;
+}
+
+static int encode_indexed_bmp(buffer_t *output, buffer_t *scratch,
+    indexed_image_t const *image)
+{
+    (void) scratch;
+
+    NME_ASSERT(image != NULL && image->number_of_colors <= 256);
+
+    size_t const width = image->width;
+    size_t const height = image->height;
+
+    size_t const stride = (width + 3) & ~(size_t) 3;
+    size_t const palette_size = 4 * image->number_of_colors;
+    size_t const offset = 14 + 40 + palette_size;
+
+    if (image->number_of_alphas != 0 || stride * height > INT32_MAX - offset) {
+        return NME_FALSE;
+    }
+
+    uint32_t const fields[13] = {
+        (uint32_t) (offset + stride * height), 0, (uint32_t) offset, 40,
+        (uint32_t) width, (uint32_t) height, 1 | 8 << 16, 0,
+        (uint32_t) (stride * height), 2835, 2835,
+        (uint32_t) image->number_of_colors, 0
+    };
+
+    uint8_t *header = append_to_buffer(output, NULL, offset);
+
+    header[0] = 'B';
+    header[1] = 'M';
+
+    for (size_t i = 0; i < 13; ++i) {
+        for (size_t j = 0; j < 4; ++j) {
+            header[2 + 4 * i + j] = (uint8_t) (fields[i] >> 8 * j);
+        }
+    }
+
+    uint8_t *colors = header + 54;
+
+    for (size_t i = 0; i < image->number_of_colors; ++i, colors += 4) {
+        colors[0] = image->palette[i][2];
+        colors[1] = image->palette[i][1];
+        colors[2] = image->palette[i][0];
+        colors[3] = 0;
+    }
+
+    uint8_t *rows = append_to_buffer(output, NULL, stride * height);
+
+    for (size_t y = 0; y < height; ++y, rows += stride) {
+        memcpy(rows, image->indices + image->stride * (height - y - 1), width);
+        memset(rows + width, 0x00, stride - width);
+    }
+
+    return NME_TRUE;
+}
+
+static void begin_png_image(buffer_t *output, size_t width, size_t height,
+    uint8_t color_type)
+{
+    uint8_t header[13] = { 0 };
+
+    write_big_endian(header, (uint32_t) width);
+    write_big_endian(header + 4, (uint32_t) height);
+
+    header[8] = 8;
+    header[9] = color_type;
+
+    append_to_buffer(output, "\x89PNG\r\n\x1A\n", 8);
+    write_png_chunk(output, "IHDR", header, sizeof (header));
+}
+
+static int end_png_image(buffer_t *output, uint8_t *scanlines, size_t size,
+    size_t channels, size_t stride)
+{
+    size_t offset = begin_png_chunk(output, "IDAT");
+
+    if (NME_PNG_COMPRESSION_LEVEL < 0 || NME_PNG_COMPRESSION_LEVEL > 1) {
+        int length = 0;
+        uint8_t *compressed = stbi_zlib_compress(scanlines, (int) size,
+            &length, stbi_write_png_compression_level);
+
+        if (compressed == NULL) {
+            return NME_FALSE;
+        }
+
+        append_to_buffer(output, compressed, (size_t) length);
+        free(compressed);
+    } else {
+        append_to_buffer(output, "\x78\x01", 2);
+
+        if (NME_PNG_COMPRESSION_LEVEL == 0) {
+            deflate_stored(output, scanlines, size);
+        } else {
+            deflate_fixed(output, scanlines, size, channels, stride);
+        }
+
+        uint8_t adler[4];
+
+        write_big_endian(adler, compute_adler(scanlines, size));
+        append_to_buffer(output, adler, sizeof (adler));
+    }
+
+    end_png_chunk(output, offset);
+    write_png_chunk(output, "IEND", NULL, 0);
+
+    return NME_TRUE;
+}
+
+static int encode_png(buffer_t *output, buffer_t *scratch,
+    uint8_t const *pixel_data, size_t width, size_t height, size_t channels)
+{
+    if (NME_PNG_COMPRESSION_LEVEL < 0 || NME_PNG_COMPRESSION_LEVEL > 1) {
+        return stbi_write_png_to_func(write_to_buffer, output, (int) width,
+            (int) height, (int) channels, pixel_data, 0) != 0;
+    }
+
+    size_t const stride = width * channels + 1;
+    size_t const size = stride * height;
+
+    if (width == 0 || height == 0 || size > INT32_MAX / 2) {
+        return NME_FALSE;
+    }
+
+    uint8_t *scanlines = reserve_scratch(scratch, size);
+
+    for (size_t y = 0; y < height; ++y) {
+        scanlines[stride * y] = 0;
+
+        memcpy(scanlines + stride * y + 1, pixel_data + (stride - 1) * y,
+            stride - 1);
+    }
+
+    begin_png_image(output, width, height, (channels == 4) ? 6 : 2);
+    return end_png_image(output, scanlines, size, channels, stride);
+}
+
+static int encode_indexed_png(buffer_t *output, buffer_t *scratch,
+    indexed_image_t const *image)
+{
+    NME_ASSERT(image != NULL && image->number_of_colors <= 256);
+
+    size_t const width = image->width;
+    size_t const height = image->height;
+
+    size_t const stride = width + 1;
+    size_t const size = stride * height;
+
+    if (width == 0 || height == 0 || size > INT32_MAX / 2) {
+        return NME_FALSE;
+    }
+
+    uint8_t *scanlines = reserve_scratch(scratch, size);
+
+    for (size_t y = 0; y < height; ++y) {
+        scanlines[stride * y] = 0;
+
+        memcpy(scanlines + stride * y + 1, image->indices + image->stride * y,
+            width);
+    }
+
+    begin_png_image(output, width, height, 3);
+
+    size_t offset = begin_png_chunk(output, "PLTE");
+
+    uint8_t *colors = append_to_buffer(output, NULL,
+        3 * image->number_of_colors);
+
+    for (size_t i = 0; i < image->number_of_colors; ++i) {
+        memcpy(colors + 3 * i, image->palette[i], 3);
+    }
+
+    end_png_chunk(output, offset);
+
+    if (image->number_of_alphas != 0) {
+        offset = begin_png_chunk(output, "tRNS");
+
+        uint8_t *alphas = append_to_buffer(output, NULL,
+            image->number_of_alphas);
+
+        for (size_t i = 0; i < image->number_of_alphas; ++i) {
+            alphas[i] = image->palette[i][3];
+        }
+
+        end_png_chunk(output, offset);
+    }
+
+    return end_png_image(output, scanlines, size, 1, stride);
+}
+
+static int encode_ppm(buffer_t *output, buffer_t *scratch,
+    uint8_t const *pixel_data, size_t width, size_t height, size_t channels)
+{
+    (void) scratch;
+
+    char header[64];
+    int length = snprintf(header, sizeof (header), "P6\n%zu %zu\n255\n",
+        width, height);
+
+    append_to_buffer(output, header, (size_t) length);
+
+    size_t const number_of_pixels = width * height;
+
+    if (channels == 3) {
+        append_to_buffer(output, pixel_data, number_of_pixels * 3);
+        return NME_TRUE;
+    }
+
+    uint8_t *destination = append_to_buffer(output, NULL,
+        number_of_pixels * 3);
+
+    for (size_t i = 0; i < number_of_pixels; ++i, pixel_data += channels) {
+        memcpy(destination + 3 * i, pixel_data, 3);
+    }
+
+    return NME_TRUE;
+}
+
+static int encode_qoi(buffer_t *output, buffer_t *scratch,
+    uint8_t const *pixel_data, size_t width, size_t height, size_t channels)
+{
+    (void) scratch;
+
+    size_t const number_of_pixels = width * height;
+
+    size_t offset = output->size;
+    append_to_buffer(output, NULL, 14 + number_of_pixels * (channels + 1) + 8);
+
+    uint8_t *cursor = output->data + offset;
+
+    memcpy(cursor, "qoif", 4);
+
+    write_big_endian(cursor + 4, (uint32_t) width);
+    write_big_endian(cursor + 8, (uint32_t) height);
+
+    cursor[12] = (uint8_t) channels;
+    cursor[13] = 0;
+
+    cursor += 14;
+
+    uint8_t seen[64][4];
+    memset(seen, 0x00, sizeof (seen));
+
+    uint8_t previous[4] = { 0, 0, 0, 255 };
+    size_t run = 0;
+
+    for (size_t i = 0; i < number_of_pixels; ++i, pixel_data += channels) {
+        uint8_t const pixel[4] = {
+            pixel_data[0], pixel_data[1], pixel_data[2],
+            (channels == 4) ? pixel_data[3] : 255
+        };
+
+        if (memcmp(pixel, previous, 4) == 0) {
+            if (++run == 62 || i + 1 == number_of_pixels) {
+                *(cursor++) = (uint8_t) (0xC0 | (run - 1));
+                run = 0;
+            }
+
+            continue;
+        }
+
+        if (run != 0) {
+            *(cursor++) = (uint8_t) (0xC0 | (run - 1));
+            run = 0;
+        }
+
+        size_t slot = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 +
+            pixel[3] * 11) % 64;
+
+        if (memcmp(seen[slot], pixel, 4) == 0) {
+            *(cursor++) = (uint8_t) slot;
+        } else if (pixel[3] != previous[3]) {
+            *(cursor++) = 0xFF;
+
+            memcpy(cursor, pixel, 4);
+            cursor += 4;
+        } else {
+            int dr = (int8_t) (pixel[0] - previous[0]);
+            int dg = (int8_t) (pixel[1] - previous[1]);
+            int db = (int8_t) (pixel[2] - previous[2]);
+
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 &&
+                db >= -2 && db <= 1) {
+                *(cursor++) = (uint8_t) (0x40 | (dr + 2) << 4 |
+                    (dg + 2) << 2 | (db + 2));
+            } else if (dg >= -32 && dg <= 31 && dr - dg >= -8 &&
+                dr - dg <= 7 && db - dg >= -8 && db - dg <= 7) {
+                *(cursor++) = (uint8_t) (0x80 | (dg + 32));
+                *(cursor++) = (uint8_t) ((dr - dg + 8) << 4 | (db - dg + 8));
+            } else {
+                *(cursor++) = 0xFE;
+
+                memcpy(cursor, pixel, 3);
+                cursor += 3;
+            }
+        }
+
+        memcpy(seen[slot], pixel, 4);
+        memcpy(previous, pixel, 4);
+    }
+
+    memcpy(cursor, "\0\0\0\0\0\0\0\1", 8);
+    cursor += 8;
+
+    output->size = cursor - output->data;
+    return NME_TRUE;
+}
+
+static int encode_rgba(buffer_t *output, buffer_t *scratch,
+    uint8_t const *pixel_data, size_t width, size_t height, size_t channels)
+{
+    (void) scratch;
+
+    NME_ASSERT(channels == 4);
+    append_to_buffer(output, pixel_data, width * height * 4);
+
+    return NME_TRUE;
+}
+
+static encoder_t const NME_ENCODERS[] = {
+    { "bmp", "bmp", NME_FALSE, encode_bmp, encode_indexed_bmp },
+    { "png", "png", NME_FALSE, encode_png, encode_indexed_png },
+    { "ppm", "ppm", NME_FALSE, encode_ppm, NULL },
+    { "qoi", "qoi", NME_FALSE, encode_qoi, NULL },
+    { "rgba", "rgba", NME_TRUE, encode_rgba, NULL },
+    { NULL, NULL, NME_FALSE, NULL, NULL }
+};
+
+static encoder_t const *const NME_BMP_ENCODER = &NME_ENCODERS[0];
+static encoder_t const *const NME_PNG_ENCODER = &NME_ENCODERS[1];
+
+static encoder_t const *find_encoder(char const *name)
+{
+    for (encoder_t const *encoder = NME_ENCODERS; encoder->name != NULL;
+        ++encoder) {
+        if (stricmp(encoder->name, name) == 0) {
+            return encoder;
+        }
+    }
+
+    return NULL;
+}
+
+static void save_encoded_image(worker_t *worker, image_t const *image,
+    char const *extension)
+{
+    buffer_t const *encoded = &worker->encoded;
+    add_to_statistic(&NME_STATISTICS.bytes_encoded, encoded->size);
+
+    wad_t *parent = image->parent;
+
+    char *path = get_path_for_image(&worker->arena, image, extension);
+    create_directory_for_file(path);
+
+    dump_to_file_at(&parent->descriptor, path + strlen(parent->path) + 1,
+        path, encoded->data, encoded->size);
+}
+
+static void write_image(worker_t *worker, image_t const *image,
+    encoder_t const *encoder, char const *extension,
+    uint8_t const *pixel_data, size_t channels)
+{
+    NME_ASSERT(worker != NULL && image != NULL && encoder != NULL);
+
+    buffer_t *encoded = &worker->encoded;
+    encoded->size = 0;
+
+    uint64_t start = start_timer();
+
+    if (encoder->encode(encoded, &worker->scanlines, pixel_data, image->width,
+        image->height, channels) == NME_FALSE) {
+        report("unable to encode image `%s`", image->name);
+        return;
+    }
+
+    stop_timer(&NME_STATISTICS.encode_time, start);
+    save_encoded_image(worker, image, extension);
+}
+
+static int write_indexed_image(worker_t *worker, image_t const *image,
+    encoder_t const *encoder, char const *extension,
+    indexed_image_t const *indexed)
+{
+    NME_ASSERT(worker != NULL && image != NULL && encoder != NULL);
+
+    buffer_t *encoded = &worker->encoded;
+    encoded->size = 0;
+
+    uint64_t start = start_timer();
+
+    if (encoder->encode_indexed(encoded, &worker->scanlines,
+        indexed) == NME_FALSE) {
+        return NME_FALSE;
+    }
+
+    stop_timer(&NME_STATISTICS.encode_time, start);
+    add_to_statistic(&NME_STATISTICS.images_indexed, 1);
+
+    save_encoded_image(worker, image, extension);
+    return NME_TRUE;
+}
+
+static encoder_t const *select_image_encoder(image_t const *image,
+    char const **extension)
+{
+    NME_ASSERT(image != NULL && extension != NULL);
+
+    if (has_extension(image->name, "rle") == NME_TRUE) {
+        encoder_t const *encoder = (NME_ENCODER != NULL) ? NME_ENCODER :
+            NME_PNG_ENCODER;
+
+        *extension = encoder->extension;
+        return encoder;
+    }
+
+    if (NME_ENCODER != NULL) {
+        *extension = NME_ENCODER->extension;
+        return NME_ENCODER;
+    }
+
+    *extension = NULL;
+    return NME_BMP_ENCODER;
+}
+
+static int has_bmp_pixel_data(image_t const *image)
+{
+    NME_ASSERT(image != NULL);
+
+    size_t const width = image->width;
+    size_t const height = image->height;
+
+    return (height == 0 ||
+        (height - 1) * (width + 2) + width <= image->pixel_data_size);
+}
+
+static int has_rle_dimensions(image_t const *image)
+{
+    NME_ASSERT(image != NULL);
+
+    return (image->width <= NME_MAXIMUM_RLE_SIZE &&
+        image->height <= NME_MAXIMUM_RLE_SIZE);
+}
+
+static void decode_bmp_image(uint8_t *pixel_data, image_t const *image,
+    size_t channels)
+{
+    NME_ASSERT(pixel_data != NULL && image != NULL);
+
+    size_t const width = image->width;
+    size_t const height = image->height;
+
+    uint32_t const *colors = image->parent->colors +
+        256 * (size_t) image->palette_id;
+
+    for (size_t y = 0; y < height; ++y) {
+        uint8_t *destination = pixel_data + channels * width * y;
+        uint8_t const *source = image->pixel_data + (width + 2) * y;
+
+        if (channels == 4) {
+            NME_CONVERT_ROW_TO_RGBA(destination, source, width, colors, 255);
+        } else {
+            NME_CONVERT_ROW_TO_RGB(destination, source, width, colors);
+        }
+    }
+}
+
+static int extract_indexed_bmp_image(worker_t *worker, image_t const *image,
+    encoder_t const *encoder, char const *extension)
+{
+    NME_ASSERT(worker != NULL && image != NULL && encoder != NULL);
+
+    indexed_image_t indexed;
+
+    indexed.indices = image->pixel_data;
+    indexed.width = image->width;
+    indexed.height = image->height;
+    indexed.stride = indexed.width + 2;
+
+    uint64_t start = start_timer();
+    uint8_t maximum = 0;
+
+    for (size_t y = 0; y < indexed.height; ++y) {
+        uint8_t const *source = indexed.indices + indexed.stride * y;
+
+        for (size_t x = 0; x < indexed.width; ++x) {
+            maximum = (source[x] > maximum) ? source[x] : maximum;
+        }
+    }
+
+    indexed.number_of_colors = (size_t) maximum + 1;
+    indexed.number_of_alphas = 0;
+
+    memcpy(indexed.palette, image->parent->colors + 256 *
+        (size_t) image->palette_id, 4 * indexed.number_of_colors);
+
+    stop_timer(&NME_STATISTICS.decode_time, start);
+
+    if (write_indexed_image(worker, image, encoder, extension,
+        &indexed) == NME_FALSE) {
+        return NME_FALSE;
+    }
+
+    add_to_statistic(&NME_STATISTICS.bmp_images_decoded, 1);
+    return NME_TRUE;
+}
+
+static void extract_bmp_image(worker_t *worker, image_t const *image)
+{
+    NME_ASSERT(image != NULL && image->parent != NULL);
+
+    wad_t const *parent = image->parent;
+
+    NME_ASSERT(parent->colors != NULL);
+    NME_ASSERT(image->palette_id < parent->number_of_palettes);
+
+    if (has_bmp_pixel_data(image) == NME_FALSE) {
+        report("corrupt image `%s`", image->name);
+        return;
+    }
+
+    char const *extension = NULL;
+    encoder_t const *encoder = select_image_encoder(image, &extension);
+
+    if (NME_INDEXED_OUTPUT == NME_TRUE && encoder->encode_indexed != NULL &&
+        extract_indexed_bmp_image(worker, image, encoder,
+        extension) == NME_TRUE) {
+        return;
+    }
+
+    size_t const channels = (encoder->requires_alpha == NME_TRUE) ? 4 : 3;
+
+    uint8_t *pixel_data = reserve_scratch(&worker->pixels,
+        (size_t) image->width * image->height * channels);
+
+    uint64_t start = start_timer();
+    decode_bmp_image(pixel_data, image, channels);
+
+    stop_timer(&NME_STATISTICS.decode_time, start);
+    add_to_statistic(&NME_STATISTICS.bmp_images_decoded, 1);
+
+    write_image(worker, image, encoder, extension, pixel_data, channels);
+}
+
+static void fill_transparent_run(uint8_t *destination, size_t count)
+{
+    static uint8_t const pattern[16] = {
+        255, 0, 255, 0, 255, 0, 255, 0, 255, 0, 255, 0, 255, 0, 255, 0
+    };
+
+    for (; count >= 4; count -= 4, destination += 16) {
+        memcpy(destination, pattern, 16);
+    }
+
+    memcpy(destination, pattern, count << 2);
+}
+
+static int decode_rle_image(uint8_t *pixel_data, image_t const *image)
+{
+    NME_ASSERT(pixel_data != NULL && image != NULL);
+
+    uint8_t const *source = image->pixel_data;
+    size_t const size = image->pixel_data_size;
+
+    uint32_t const *colors = image->parent->colors +
+        256 * (size_t) image->palette_id;
+
+    size_t const number_of_pixels = (size_t) image->width * image->height;
+
+    size_t index = 0;
+    size_t tracker = 0;
+
+    while (index < size) {
+        size_t count = source[index++];
+        uint8_t alpha = 255;
+
+        if (count == 0xFF || count == 0xFE) {
+            if (index == size) {
+                return NME_FALSE;
+            }
+
+            alpha = (count == 0xFF) ? 0 : 127;
+            count = source[index++];
+        }
+
+        if (count > number_of_pixels - tracker) {
+            return NME_FALSE;
+        }
+
+        if (alpha == 0) {
+            fill_transparent_run(pixel_data + (tracker << 2), count);
+            tracker += count;
+
+            continue;
+        }
+
+        if (count > size - index) {
+            return NME_FALSE;
+        }
+
+        NME_CONVERT_ROW_TO_RGBA(pixel_data + (tracker << 2), source + index,
+            count, colors, alpha);
+
+        index += count;
+        tracker += count;
+    }
+
+    memset(pixel_data + (tracker << 2), 0x00,
+        (number_of_pixels - tracker) << 2);
+
+    return NME_TRUE;
+}
+
+static int index_rle_image(image_t const *image, uint16_t *slots,
+    uint8_t *indices)
+{
+    NME_ASSERT(image != NULL && slots != NULL);
+
+    uint8_t const *source = image->pixel_data;
+    size_t const size = image->pixel_data_size;
+
+    size_t const number_of_pixels = (size_t) image->width * image->height;
+
+    size_t index = 0;
+    size_t tracker = 0;
+
+    while (index < size) {
+        size_t count = source[index++];
+        size_t key = 0;
+
+        if (count == 0xFF || count == 0xFE) {
+            if (index == size) {
+                return NME_FALSE;
+            }
+
+            key = (count == 0xFF) ? 512 : 256;
+            count = source[index++];
+        }
+
+        if (count > number_of_pixels - tracker) {
+            return NME_FALSE;
+        }
+
+        if (key == 512) {
+            if (indices != NULL) {
+                memset(indices + tracker, slots[key], count);
+            } else if (count != 0) {
+                slots[key] = 1;
+            }
+
+            tracker += count;
+            continue;
+        }
+
+        if (count > size - index) {
+            return NME_FALSE;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            if (indices != NULL) {
+                indices[tracker + i] = (uint8_t) slots[key + source[index + i]];
+            } else {
+                slots[key + source[index + i]] = 1;
+            }
+        }
+
+        index += count;
+        tracker += count;
+    }
+
+    if (indices != NULL) {
+        memset(indices + tracker, slots[513], number_of_pixels - tracker);
+    } else if (tracker < number_of_pixels) {
+        slots[513] = 1;
+    }
+
+    return NME_TRUE;
+}
+
+static int extract_indexed_rle_image(worker_t *worker, image_t const *image,
+    encoder_t const *encoder, char const *extension)
+{
+    NME_ASSERT(worker != NULL && image != NULL && encoder != NULL);
+
+    uint16_t slots[514];
+    memset(slots, 0x00, sizeof (slots));
+
+    uint64_t start = start_timer();
+
+    if (index_rle_image(image, slots, NULL) == NME_FALSE) {
+        return NME_FALSE;
+    }
+
+    uint8_t const *colors = (uint8_t const *) (image->parent->colors + 256 *
+        (size_t) image->palette_id);
+
+    indexed_image_t indexed;
+
+    indexed.number_of_colors = 0;
+    indexed.number_of_alphas = 0;
+
+    for (size_t i = 0; i < 514; ++i) {
+        size_t key = (i < 2) ? 512 + i : (i < 258) ? 254 + i : i - 258;
+
+        if (slots[key] == 0) {
+            continue;
+        }
+
+        if (indexed.number_of_colors == 256) {
+            return NME_FALSE;
+        }
+
+        uint8_t *color = indexed.palette[indexed.number_of_colors];
+
+        if (key >= 512) {
+            uint8_t const fill[2][4] = { { 255, 0, 255, 0 }, { 0, 0, 0, 0 } };
+            memcpy(color, fill[key - 512], 4);
+        } else {
+            memcpy(color, colors + 4 * (key & 0xFF), 3);
+            color[3] = (key < 256) ? 255 : 127;
+        }
+
+        indexed.number_of_alphas += (key >= 256);
+        slots[key] = (uint16_t) indexed.number_of_colors++;
+    }
+
+    size_t const number_of_pixels = (size_t) image->width * image->height;
+    uint8_t *indices = reserve_scratch(&worker->pixels, number_of_pixels);
+
+    index_rle_image(image, slots, indices);
+
+    indexed.indices = indices;
+    indexed.width = image->width;
+    indexed.height = image->height;
+    indexed.stride = indexed.width;
+
+    stop_timer(&NME_STATISTICS.decode_time, start);
+
+    if (write_indexed_image(worker, image, encoder, extension,
+        &indexed) == NME_FALSE) {
+        return NME_FALSE;
+    }
+
+    add_to_statistic(&NME_STATISTICS.rle_images_decoded, 1);
+    return NME_TRUE;
+}
+
+static void extract_rle_image(worker_t *worker, image_t const *image)
+{
+    NME_ASSERT(image != NULL && image->parent != NULL);
+    NME_ASSERT(image->pixel_data != NULL);
+
+    wad_t const *parent = image->parent;
+
+    NME_ASSERT(parent->colors != NULL);
+    NME_ASSERT(image->palette_id < parent->number_of_palettes);
+
+    if (has_rle_dimensions(image) == NME_FALSE) {
+        report("corrupt image `%s`", image->name);
+        return;
+    }
+
+    size_t const number_of_pixels = (size_t) image->width * image->height;
+
+    char const *extension = NULL;
+    encoder_t const *encoder = select_image_encoder(image, &extension);
+
+    if (NME_INDEXED_OUTPUT == NME_TRUE && encoder->encode_indexed != NULL &&
+        extract_indexed_rle_image(worker, image, encoder,
+        extension) == NME_TRUE) {
+        return;
+    }
+
+    uint8_t *pixel_data = reserve_scratch(&worker->pixels,
+        number_of_pixels << 2);
+
+    uint64_t start = start_timer();
+
+    if (decode_rle_image(pixel_data, image) == NME_FALSE) {
+        report("corrupt image `%s`", image->name);
+        return;
+    }
+
+    stop_timer(&NME_STATISTICS.decode_time, start);
+    add_to_statistic(&NME_STATISTICS.rle_images_decoded, 1);
+
+    write_image(worker, image, encoder, extension, pixel_data, 4);
+}
+
+static int64_t get_file_size(char const *filename)
+{
+    NME_ASSERT(filename != NULL);
+
+#if defined (NME_POSIX)
+    struct stat status;
+
+    if (stat(filename, &status) != 0 || S_ISREG(status.st_mode) == 0) {
+        return -1;
+    }
+
+    return (int64_t) status.st_size;
+#else
+    FILE *file = fopen(filename, "rb");
+
+    if (file == NULL) {
+        return -1;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+
+    fclose(file);
+    return (int64_t) length;
+#endif
+}
+
+static char *get_manifest_filename(archive_t const *archive,
+    char const *suffix)
+{
+    NME_ASSERT(archive != NULL && archive->output_path != NULL);
+
+    char *filename = allocate(strlen(archive->output_path) +
+        strlen(NME_MANIFEST_NAME) + strlen(suffix) + 2);
+
+    sprintf(filename, "%s%c%s%s", archive->output_path, NME_PATH_SEPARATOR,
+        NME_MANIFEST_NAME, suffix);
+
+    return filename;
+}
+
+static void format_manifest_header(char *header, size_t size)
+{
+    snprintf(header, size, "nme-manifest %u %s%s %d\n", NME_MANIFEST_VERSION,
+        (NME_ENCODER != NULL) ? NME_ENCODER->name : "auto",
+        (NME_INDEXED_OUTPUT == NME_TRUE) ? "-indexed" : "",
+        NME_PNG_COMPRESSION_LEVEL);
+}
+
+static void parse_manifest(manifest_t *manifest, char *data,
+    char const *filename)
+{
+    NME_ASSERT(manifest != NULL && data != NULL);
+
+    char header[64];
+    format_manifest_header(header, sizeof (header));
+
+    if (strncmp(data, header, strlen(header)) != 0) {
+        report("ignoring stale manifest `%s`", filename);
+        return;
+    }
+
+    for (char *line = data + strlen(header); *line != '\0';) {
+        char *end = strchr(line, '\n');
+
+        if (end == NULL) {
+            break;
+        }
+
+        char *fields[5] = { line, NULL, NULL, NULL, NULL };
+        size_t number_of_fields = 1;
+
+        for (char *cursor = line; cursor < end && number_of_fields < 5;
+            ++cursor) {
+            if (*cursor == '\t') {
+                fields[number_of_fields++] = cursor + 1;
+            }
+        }
+
+        if (number_of_fields == 5) {
+            size_t length = (size_t) (fields[1] - fields[0]);
+
+            memmove(fields[0] + length, fields[3],
+                (size_t) (fields[4] - fields[3] - 1));
+
+            insert_string(manifest->previous, fields[0],
+                length + (size_t) (fields[4] - fields[3] - 1));
+        }
+
+        line = end + 1;
+    }
+}
+
+static manifest_t *load_manifest(archive_t const *archive)
+{
+    NME_ASSERT(archive != NULL);
+
+    manifest_t *manifest = allocate(sizeof (manifest_t));
+
+    manifest->previous = create_string_set(NME_STRING_SET_CAPACITY);
+    create_mutex(&manifest->mutex);
+
+    char *filename = get_manifest_filename(archive, "");
+    FILE *file = fopen(filename, "rb");
+
+    if (file == NULL) {
+        release(filename);
+        return manifest;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (length > 0) {
+        char *data = allocate((size_t) length + 1);
+
+        if (fread(data, (size_t) length, 1, file) == 1) {
+            parse_manifest(manifest, data, filename);
+        } else {
+            report("ignoring unreadable manifest `%s`", filename);
+        }
+
+        release(data);
+    }
+
+    fclose(file);
+    release(filename);
+
+    return manifest;
+}
+
+static void save_manifest(archive_t const *archive)
+{
+    NME_ASSERT(archive != NULL && archive->manifest != NULL);
+
+    char *filename = get_manifest_filename(archive, "");
+    char *temporary_filename = get_manifest_filename(archive, ".tmp");
+
+    create_directory_for_file(temporary_filename);
+    FILE *file = fopen(temporary_filename, "wb");
+
+    if (file == NULL) {
+        report("unable to write manifest `%s`", filename);
+    } else {
+        char header[64];
+        format_manifest_header(header, sizeof (header));
+
+        buffer_t const *records = &archive->manifest->records;
+
+        write_into_file(file, header, strlen(header));
+
+        if (records->size != 0) {
+            write_into_file(file, records->data, records->size);
+        }
+
+        fclose(file);
+
+#if !defined (NME_POSIX)
+        remove(filename);
+#endif
+
+        if (rename(temporary_filename, filename) != 0) {
+            report("unable to write manifest `%s`", filename);
+        }
+    }
+
+    release(temporary_filename);
+    release(filename);
+}
+
+static void free_manifest(manifest_t *manifest)
+{
+    if (manifest == NULL) {
+        return;
+    }
+
+    free_string_set(manifest->previous);
+    free_buffer(&manifest->records);
+
+    free_mutex(&manifest->mutex);
+    release(manifest);
+}
+
+static int is_manifest_path_valid(char const *path)
+{
+    return strpbrk(path, "\t\n") == NULL;
+}
+
+static int check_manifest(worker_t *worker, manifest_t *manifest,
+    char const *path, size_t offset, size_t size, uint64_t hash,
+    char const *output_path)
+{
+    NME_ASSERT(manifest != NULL && path != NULL && output_path != NULL);
+
+    if (is_manifest_path_valid(path) == NME_FALSE ||
+        is_manifest_path_valid(output_path) == NME_FALSE) {
+        return NME_FALSE;
+    }
+
+    char *key = allocate_from_arena(&worker->arena, strlen(path) + 18);
+    int length = sprintf(key, "%s\t%016llx", path, (unsigned long long) hash);
+
+    buffer_t *records = &manifest->records;
+    lock_mutex(&manifest->mutex);
+
+    reserve_buffer(records, strlen(path) + strlen(output_path) + 64);
+    records->size += (size_t) sprintf((char *) records->data + records->size,
+        "%s\t%zu\t%zu\t%016llx\t%s\n", path, offset, size,
+        (unsigned long long) hash, output_path);
+
+    unlock_mutex(&manifest->mutex);
+
+    return find_string(manifest->previous, key, (size_t) length) != NULL;
+}
+
+static int skip_unchanged_entry(worker_t *worker, entry_t const *entry,
+    char const *output_path)
+{
+    NME_ASSERT(entry != NULL && output_path != NULL);
+
+    archive_t const *archive = entry->parent->archive;
+
+    arena_mark_t mark = mark_arena(&worker->arena);
+    char *path = get_archive_path_for_entry(&worker->arena, entry, 0);
+
+    uint64_t hash = hash_data(0, view_input(archive, entry->offset,
+        entry->size), entry->size);
+
+    int is_unchanged = check_manifest(worker, archive->manifest, path,
+        entry->offset, entry->size, hash, output_path) == NME_TRUE &&
+        get_file_size(output_path) == (int64_t) entry->size;
+
+    rewind_arena(&worker->arena, mark);
+
+    if (is_unchanged == NME_TRUE) {
+        add_to_statistic(&NME_STATISTICS.bytes_read, entry->size);
+        add_to_statistic(&NME_STATISTICS.files_skipped, 1);
+    }
+
+    return is_unchanged;
+}
+
+static uint64_t hash_image(image_t const *image)
+{
+    NME_ASSERT(image != NULL && image->parent != NULL);
+
+    wad_t const *parent = image->parent;
+
+    uint64_t hash = hash_data(((uint64_t) image->width << 32) | image->height,
+        image->pixel_data, image->pixel_data_size);
+
+    if (image->palette_id < parent->number_of_palettes) {
+        palette_t const *palette = &parent->palettes[image->palette_id];
+        hash = hash_data(hash, palette->colors, sizeof (palette->colors));
+    }
+
+    return hash;
+}
+
+static int skip_unchanged_image(worker_t *worker, image_t const *image,
+    char const *path)
+{
+    NME_ASSERT(image != NULL && image->parent != NULL && path != NULL);
+
+    wad_t const *parent = image->parent;
+    archive_t const *archive = parent->archive;
+
+    uint64_t hash = hash_image(image);
+    char const *extension = NULL;
+    select_image_encoder(image, &extension);
+
+    arena_mark_t mark = mark_arena(&worker->arena);
+    char *output_path = get_path_for_image(&worker->arena, image, extension);
+
+    int is_unchanged = check_manifest(worker, archive->manifest, path,
+        (size_t) (image->pixel_data - archive->data), image->pixel_data_size,
+        hash, output_path) == NME_TRUE && get_file_size(output_path) >= 0;
+
+    rewind_arena(&worker->arena, mark);
+
+    if (is_unchanged == NME_TRUE) {
+        add_to_statistic(&NME_STATISTICS.images_skipped, 1);
+    }
+
+    return is_unchanged;
+}
+
+static deduplicator_t *create_deduplicator(void)
+{
+    deduplicator_t *deduplicator = allocate(sizeof (deduplicator_t));
+
+    deduplicator->capacity = NME_STRING_SET_CAPACITY;
+    deduplicator->count = 0;
+
+    deduplicator->duplicates = allocate(sizeof (duplicate_t *) *
+        deduplicator->capacity);
+
+    memset(deduplicator->duplicates, 0x00, sizeof (duplicate_t *) *
+        deduplicator->capacity);
+
+    create_mutex(&deduplicator->mutex);
+    return deduplicator;
+}
+
+static void free_deduplicator(deduplicator_t *deduplicator)
+{
+    if (deduplicator == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < deduplicator->capacity; ++i) {
+        release(deduplicator->duplicates[i]);
+    }
+
+    free_mutex(&deduplicator->mutex);
+
+    release(deduplicator->duplicates);
+    release(deduplicator);
+}
+
+static int is_same_source(duplicate_t const *first, duplicate_t const *second)
+{
+    if (first->hash != second->hash || first->kind != second->kind ||
+        first->size != second->size || first->width != second->width ||
+        first->height != second->height) {
+        return NME_FALSE;
+    }
+
+    if ((first->palette == NULL) != (second->palette == NULL) ||
+        (first->palette != NULL && memcmp(first->palette->colors,
+        second->palette->colors, sizeof (first->palette->colors)) != 0)) {
+        return NME_FALSE;
+    }
+
+    return memcmp(first->data, second->data, first->size) == 0;
+}
+
+static duplicate_t **find_duplicate_slot_locked(
+    deduplicator_t *deduplicator, duplicate_t const *source)
+{
+    size_t const mask = deduplicator->capacity - 1;
+
+    for (size_t i = (size_t) source->hash & mask;; i = (i + 1) & mask) {
+        duplicate_t **slot = &deduplicator->duplicates[i];
+
+        if (*slot == NULL || is_same_source(*slot, source) == NME_TRUE) {
+            return slot;
+        }
+    }
+}
+
+static char const *find_duplicate(duplicate_t const *source)
+{
+    deduplicator_t *deduplicator = NME_DEDUPLICATOR;
+    lock_mutex(&deduplicator->mutex);
+
+    duplicate_t *duplicate = *find_duplicate_slot_locked(deduplicator, source);
+    unlock_mutex(&deduplicator->mutex);
+
+    return (duplicate != NULL) ? duplicate->path : NULL;
+}
+
+static void remember_duplicate(duplicate_t const *source, char const *path)
+{
+    NME_ASSERT(source != NULL && path != NULL);
+
+    deduplicator_t *deduplicator = NME_DEDUPLICATOR;
+    lock_mutex(&deduplicator->mutex);
+
+    duplicate_t **slot = find_duplicate_slot_locked(deduplicator, source);
+
+    if (*slot != NULL) {
+        unlock_mutex(&deduplicator->mutex);
+        return;
+    }
+
+    size_t const length = strlen(path);
+
+    *slot = allocate(sizeof (duplicate_t) + length + 1);
+    **slot = *source;
+
+    (*slot)->path = (char *) (*slot + 1);
+    memcpy((*slot)->path, path, length + 1);
+
+    if (2 * ++deduplicator->count > deduplicator->capacity) {
+        duplicate_t **duplicates = deduplicator->duplicates;
+        size_t const capacity = deduplicator->capacity;
+
+        deduplicator->capacity *= 2;
+        deduplicator->duplicates = allocate(sizeof (duplicate_t *) *
+            deduplicator->capacity);
+
+        memset(deduplicator->duplicates, 0x00, sizeof (duplicate_t *) *
+            deduplicator->capacity);
+
+        for (size_t i = 0; i < capacity; ++i) {
+            if (duplicates[i] != NULL) {
+                *find_duplicate_slot_locked(deduplicator, duplicates[i]) =
+                    duplicates[i];
+            }
+        }
+
+        release(duplicates);
+    }
+
+    unlock_mutex(&deduplicator->mutex);
+}
+
+static int link_duplicate(char const *existing, char const *path)
+{
+    NME_ASSERT(existing != NULL && path != NULL);
+
+#if defined (NME_POSIX)
+    uint64_t start = start_timer();
+    int is_linked = NME_FALSE;
+
+    if (NME_DEDUPLICATION == NME_DEDUPLICATE_BY_LINKING) {
+        unlink(path);
+        is_linked = (link(existing, path) == 0);
+    } else {
+        int input = open(existing, O_RDONLY | O_CLOEXEC);
+        int output = (input != -1) ? open(path, O_WRONLY | O_CREAT |
+            O_TRUNC | O_CLOEXEC, 0666) : -1;
+
+        struct stat status;
+
+        if (output != -1 && fstat(input, &status) == 0) {
+#if defined (FICLONE)
+            is_linked = (ioctl(output, FICLONE, input) == 0);
+#endif
+
+            if (is_linked == NME_FALSE) {
+                is_linked = (copy_with_kernel(output, input, 0,
+                    (size_t) status.st_size) == (size_t) status.st_size);
+            }
+        }
+
+        if (output != -1) {
+            close(output);
+        }
+
+        if (input != -1) {
+            close(input);
+        }
+    }
+
+    stop_timer(&NME_STATISTICS.io_time, start);
+    return is_linked;
+#else
+    (void) existing;
+    (void) path;
+
+    return NME_FALSE;
+#endif
+}
+
+static void describe_entry_source(duplicate_t *source, entry_t const *entry)
+{
+    NME_ASSERT(source != NULL && entry != NULL);
+
+    memset(source, 0x00, sizeof (duplicate_t));
+
+    source->data = view_input(entry->parent->archive, entry->offset,
+        entry->size);
+    source->size = entry->size;
+
+    source->hash = hash_data(0, source->data, source->size);
+}
+
+static void describe_image_source(duplicate_t *source, image_t const *image)
+{
+    NME_ASSERT(source != NULL && image != NULL && image->parent != NULL);
+
+    memset(source, 0x00, sizeof (duplicate_t));
+
+    wad_t const *parent = image->parent;
+
+    source->kind = (has_extension(image->name, "rle") == NME_TRUE) ?
+        NME_RLE_SOURCE : NME_BMP_SOURCE;
+
+    source->data = image->pixel_data;
+    source->size = image->pixel_data_size;
+
+    source->width = image->width;
+    source->height = image->height;
+
+    if (image->palette_id < parent->number_of_palettes) {
+        source->palette = &parent->palettes[image->palette_id];
+    }
+
+    source->hash = hash_image(image);
+}
+
+static int link_duplicate_output(duplicate_t const *source, char *path,
+    atomic_size_t *counter)
+{
+    char const *existing = find_duplicate(source);
+
+    if (existing == NULL) {
+        return NME_FALSE;
+    }
+
+    int64_t size = get_file_size(existing);
+    create_directory_for_file(path);
+
+    if (size < 0 || link_duplicate(existing, path) == NME_FALSE) {
+        return NME_FALSE;
+    }
+
+    atomic_fetch_add(counter, 1);
+    atomic_fetch_add(&NME_STATISTICS.bytes_deduplicated, (size_t) size);
+
+    return NME_TRUE;
+}
+
+static void print_image_information(image_t const *image)
+{
+    NME_ASSERT(image != NULL);
+
+    if (NME_VERBOSITY == NME_SILENT) {
+        return;
+    }
+
+    printf("{$ %s # %llu w %u h %u @ %u ~ %u} ", image->name,
+        (unsigned long long) image->pixel_data_size, image->width,
+        image->height, image->color_depth, image->palette_id);
+}
+
+static int read_wad_information(archive_t const *archive, wad_t *wad,
+    size_t *cursor)
+{
+    NME_ASSERT(wad != NULL && cursor != NULL);
+
+    view_from_input(archive, cursor, 400);
+
+    read_from_input(archive, &wad->number_of_palettes, cursor,
+        sizeof (uint32_t));
+
+    if (wad->number_of_palettes == 0) {
+        return NME_FALSE;
+    }
+
+    wad->palettes = view_from_input(archive, cursor,
+        wad->number_of_palettes * sizeof (palette_t));
+
+    read_from_input(archive, &wad->number_of_images, cursor, sizeof (uint32_t));
+    return NME_TRUE;
+}
+
+static image_t *read_image(archive_t const *archive, image_t *image,
+    size_t *cursor)
+{
+    NME_ASSERT(image != NULL && cursor != NULL);
+
+    read_image_information(archive, image, cursor);
+    read_image_pixel_data(archive, image, cursor);
+
+    if (has_extension(image->name, "rle") == NME_TRUE) {
+        read_image_line_offsets(archive, image, cursor);
+    }
+
+    read_from_input(archive, &image->palette_id, cursor, sizeof (uint32_t));
+    return image;
+}
+
+static image_t *skip_image(archive_t const *archive, image_t *image,
+    size_t *cursor)
+{
+    NME_ASSERT(image != NULL && cursor != NULL);
+
+    read_image_information(archive, image, cursor);
+    read_image_pixel_data(archive, image, cursor);
+
+    if (has_extension(image->name, "rle") == NME_TRUE) {
+        view_from_input(archive, cursor, sizeof (line_offsets_t) -
+            sizeof (uint32_t const *) + sizeof (uint32_t) *
+            (size_t) image->height);
+    }
+
+    read_from_input(archive, &image->palette_id, cursor, sizeof (uint32_t));
+    return image;
+}
+
+static void read_wad_table(arena_t *arena, wad_t *wad, size_t *cursor)
+{
+    NME_ASSERT(arena != NULL && wad != NULL && cursor != NULL);
+
+    size_t const minimum_image_size = sizeof (image_t) -
+        sizeof (uint8_t const *) - sizeof (line_offsets_t) -
+        sizeof (wad_t const *) + 6;
+
+    if (*cursor > wad->archive->size || wad->number_of_images >
+        (wad->archive->size - *cursor) / minimum_image_size) {
+        die("premature end of file");
+    }
+
+    wad->images = allocate_from_arena(arena, sizeof (image_t) *
+        wad->number_of_images);
+
+    for (uint32_t i = 0; i < wad->number_of_images; ++i) {
+        image_t *image = &wad->images[i];
+
+        memset(image, 0x00, sizeof (image_t));
+        image->parent = wad;
+
+        skip_image(wad->archive, image, cursor);
+    }
+}
+
+static size_t estimate_image_memory(image_t const *image)
+{
+    NME_ASSERT(image != NULL);
+
+    size_t const number_of_pixels = (size_t) image->width * image->height;
+
+    if (number_of_pixels > SIZE_MAX / 16) {
+        return SIZE_MAX;
+    }
+
+    return 3 * 4 * number_of_pixels + (size_t) image->height;
+}
+
+static int is_memory_available(pool_t const *pool, size_t size)
+{
+    return pool->memory_in_flight == 0 ||
+        (pool->memory_in_flight <= NME_MEMORY_LIMIT &&
+        size <= NME_MEMORY_LIMIT - pool->memory_in_flight);
+}
+
+static void acquire_memory(pool_t *pool, size_t size)
+{
+    NME_ASSERT(pool != NULL);
+
+    if (NME_MEMORY_LIMIT == 0) {
+        return;
+    }
+
+    lock_mutex(&pool->memory_mutex);
+
+    if (is_memory_available(pool, size) == NME_FALSE) {
+        add_to_statistic(&NME_STATISTICS.memory_waits, 1);
+    }
+
+    while (is_memory_available(pool, size) == NME_FALSE) {
+        wait_for_condition(&pool->memory_condition, &pool->memory_mutex);
+    }
+
+    pool->memory_in_flight += size;
+    unlock_mutex(&pool->memory_mutex);
+}
+
+static void release_memory(worker_t *worker, size_t size)
+{
+    NME_ASSERT(worker != NULL);
+
+    if (NME_MEMORY_LIMIT == 0) {
+        return;
+    }
+
+    pool_t *pool = worker->pool;
+    size_t const share = NME_MEMORY_LIMIT / pool->number_of_workers;
+
+    if (worker->pixels.capacity + worker->scanlines.capacity +
+        worker->encoded.capacity > share) {
+        free_buffer(&worker->pixels);
+        free_buffer(&worker->scanlines);
+        free_buffer(&worker->encoded);
+    }
+
+    lock_mutex(&pool->memory_mutex);
+
+    pool->memory_in_flight -= size;
+    broadcast_condition(&pool->memory_condition);
+
+    unlock_mutex(&pool->memory_mutex);
+}
+
+static int compare_atlas_rects(void const *first, void const *second)
+{
+    atlas_rect_t const *a = first;
+    atlas_rect_t const *b = second;
+
+    if (a->image.height != b->image.height) {
+        return (a->image.height < b->image.height) ? 1 : -1;
+    }
+
+    if (a->image.width != b->image.width) {
+        return (a->image.width < b->image.width) ? 1 : -1;
+    }
+
+    return (a->index > b->index) - (a->index < b->index);
+}
+
+static int compare_atlas_indices(void const *first, void const *second)
+{
+    atlas_rect_t const *a = first;
+    atlas_rect_t const *b = second;
+
+    return (a->index > b->index) - (a->index < b->index);
+}
+
+static int collect_atlas_rect(buffer_t *rects, image_t const *image,
+    uint32_t index)
+{
+    NME_ASSERT(rects != NULL && image != NULL && image->parent != NULL);
+
+    size_t const number_of_pixels = (size_t) image->width * image->height;
+
+    if (number_of_pixels == 0) {
+        return NME_FALSE;
+    }
+
+    int is_valid = (image->palette_id < image->parent->number_of_palettes);
+
+    if (has_extension(image->name, "rle") == NME_TRUE) {
+        is_valid &= has_rle_dimensions(image);
+    } else {
+        is_valid &= has_bmp_pixel_data(image);
+    }
+
+    if (is_valid == NME_FALSE) {
+        report("corrupt image `%s`", image->name);
+        return NME_FALSE;
+    }
+
+    atlas_rect_t rect;
+    memset(&rect, 0x00, sizeof (atlas_rect_t));
+
+    rect.image = *image;
+    rect.index = index;
+
+    append_to_buffer(rects, &rect, sizeof (atlas_rect_t));
+    return NME_TRUE;
+}
+
+static void pack_atlas(atlas_rect_t *rects, size_t number_of_rects,
+    buffer_t *pages)
+{
+    NME_ASSERT(rects != NULL && pages != NULL);
+
+    qsort(rects, number_of_rects, sizeof (atlas_rect_t), compare_atlas_rects);
+
+    size_t const size = NME_ATLAS_SIZE;
+    size_t current = SIZE_MAX;
+
+    size_t x = 0, y = 0;
+    size_t shelf_height = 0;
+
+    for (size_t i = 0; i < number_of_rects; ++i) {
+        atlas_rect_t *rect = &rects[i];
+        atlas_page_t page = { rect->image.width, rect->image.height };
+
+        size_t width = rect->image.width + NME_ATLAS_PADDING;
+        size_t height = rect->image.height + NME_ATLAS_PADDING;
+
+        if (width > size || height > size) {
+            rect->page = (uint32_t) (pages->size / sizeof (atlas_page_t));
+            append_to_buffer(pages, &page, sizeof (atlas_page_t));
+
+            continue;
+        }
+
+        if (current != SIZE_MAX && x + width > size) {
+            x = 0;
+            y += shelf_height;
+            shelf_height = 0;
+        }
+
+        if (current == SIZE_MAX || y + height > size) {
+            current = pages->size / sizeof (atlas_page_t);
+            append_to_buffer(pages, &page, sizeof (atlas_page_t));
+
+            x = y = shelf_height = 0;
+        }
+
+        rect->page = (uint32_t) current;
+        rect->x = (uint32_t) x;
+        rect->y = (uint32_t) y;
+
+        atlas_page_t *target = (atlas_page_t *) pages->data + current;
+
+        if (x + rect->image.width > target->width) {
+            target->width = (uint32_t) (x + rect->image.width);
+        }
+
+        if (y + rect->image.height > target->height) {
+            target->height = (uint32_t) (y + rect->image.height);
+        }
+
+        x += width;
+        shelf_height = (height > shelf_height) ? height : shelf_height;
+    }
+}
+
+static void draw_atlas_rect(worker_t *worker, atlas_rect_t const *rect,
+    uint8_t *page, size_t page_width)
+{
+    NME_ASSERT(worker != NULL && rect != NULL && page != NULL);
+
+    image_t const *image = &rect->image;
+
+    size_t const width = image->width;
+    size_t const height = image->height;
+
+    uint8_t *pixel_data = reserve_scratch(&worker->pixels,
+        width * height * 4);
+
+    uint64_t start = start_timer();
+
+    if (has_extension(image->name, "rle") == NME_TRUE) {
+        if (decode_rle_image(pixel_data, image) == NME_FALSE) {
+            report("corrupt image `%s`", image->name);
+            return;
+        }
+
+        add_to_statistic(&NME_STATISTICS.rle_images_decoded, 1);
+    } else {
+        decode_bmp_image(pixel_data, image, 4);
+        add_to_statistic(&NME_STATISTICS.bmp_images_decoded, 1);
+    }
+
+    for (size_t y = 0; y < height; ++y) {
+        memcpy(page + 4 * ((rect->y + y) * page_width + rect->x),
+            pixel_data + 4 * width * y, 4 * width);
+    }
+
+    stop_timer(&NME_STATISTICS.decode_time, start);
+}
+
+static void write_wad_file(worker_t *worker, wad_t *wad, char const *name,
+    void const *contents, size_t size)
+{
+    NME_ASSERT(worker != NULL && wad != NULL && name != NULL);
+
+    char *path = join_paths(&worker->arena, wad->path, name, NULL, 0);
+    create_directory_for_file(path);
+
+    dump_to_file_at(&wad->descriptor, name, path, contents, size);
+}
+
+static void append_json_string(buffer_t *output, char const *string)
+{
+    NME_ASSERT(output != NULL && string != NULL);
+
+    append_to_buffer(output, "\"", 1);
+
+    for (; *string != '\0'; ++string) {
+        unsigned char character = (unsigned char) *string;
+
+        if (character == '"' || character == '\\') {
+            char escaped[2] = { '\\', (char) character };
+            append_to_buffer(output, escaped, 2);
+        } else if (character < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof (escaped), "\\u%04x", character);
+
+            append_to_buffer(output, escaped, 6);
+        } else {
+            append_to_buffer(output, string, 1);
+        }
+    }
+
+    append_to_buffer(output, "\"", 1);
+}
+
+static void write_atlas_sidecar(worker_t *worker, wad_t *wad,
+    atlas_rect_t *rects, size_t number_of_rects,
+    atlas_page_t const *pages, size_t number_of_pages,
+    char const *extension)
+{
+    buffer_t sidecar;
+    memset(&sidecar, 0x00, sizeof (buffer_t));
+
+    char line[128];
+    int length = 0;
+
+    append_to_buffer(&sidecar, "{\n  \"pages\": [\n", 15);
+
+    for (size_t i = 0; i < number_of_pages; ++i) {
+        length = snprintf(line, sizeof (line), "    { \"file\": "
+            "\"atlas%zu.%s\", \"width\": %u, \"height\": %u }%s\n", i,
+            extension, pages[i].width, pages[i].height,
+            (i + 1 < number_of_pages) ? "," : "");
+
+        append_to_buffer(&sidecar, line, (size_t) length);
+    }
+
+    append_to_buffer(&sidecar, "  ],\n  \"images\": [\n", 19);
+    qsort(rects, number_of_rects, sizeof (atlas_rect_t),
+        compare_atlas_indices);
+
+    for (size_t i = 0; i < number_of_rects; ++i) {
+        atlas_rect_t const *rect = &rects[i];
+
+        append_to_buffer(&sidecar, "    { \"name\": ", 14);
+        append_json_string(&sidecar, rect->image.name);
+
+        length = snprintf(line, sizeof (line), ", \"page\": %u, \"x\": %u, "
+            "\"y\": %u, \"width\": %u, \"height\": %u }%s\n", rect->page,
+            rect->x, rect->y, rect->image.width, rect->image.height,
+            (i + 1 < number_of_rects) ? "," : "");
+
+        append_to_buffer(&sidecar, line, (size_t) length);
+    }
+
+    append_to_buffer(&sidecar, "  ]\n}\n", 6);
+    write_wad_file(worker, wad, "atlas.json", sidecar.data, sidecar.size);
+
+    free_buffer(&sidecar);
+}
+
+static void write_atlas(worker_t *worker, wad_t *wad, buffer_t *rects)
+{
+    NME_ASSERT(worker != NULL && wad != NULL && rects != NULL);
+
+    atlas_rect_t *data = (atlas_rect_t *) rects->data;
+    size_t const number_of_rects = rects->size / sizeof (atlas_rect_t);
+
+    buffer_t pages;
+    memset(&pages, 0x00, sizeof (buffer_t));
+
+    pack_atlas(data, number_of_rects, &pages);
+
+    encoder_t const *encoder = (NME_ENCODER != NULL) ? NME_ENCODER :
+        NME_PNG_ENCODER;
+
+    atlas_page_t const *page = (atlas_page_t const *) pages.data;
+    size_t const number_of_pages = pages.size / sizeof (atlas_page_t);
+
+    for (size_t i = 0; i < number_of_pages; ++i, ++page) {
+        size_t const size = (size_t) page->width * page->height * 4;
+
+        acquire_memory(worker->pool, 2 * size);
+        uint8_t *pixel_data = allocate(size);
+
+        for (size_t j = 0; j < number_of_rects; ++j) {
+            if (data[j].page == i) {
+                draw_atlas_rect(worker, &data[j], pixel_data, page->width);
+            }
+        }
+
+        buffer_t *encoded = &worker->encoded;
+        encoded->size = 0;
+
+        uint64_t start = start_timer();
+
+        if (encoder->encode(encoded, &worker->scanlines, pixel_data,
+            page->width, page->height, 4) == NME_TRUE) {
+            stop_timer(&NME_STATISTICS.encode_time, start);
+            add_to_statistic(&NME_STATISTICS.bytes_encoded, encoded->size);
+
+            char name[32];
+            snprintf(name, sizeof (name), "atlas%zu.%s", i,
+                encoder->extension);
+
+            write_wad_file(worker, wad, name, encoded->data, encoded->size);
+        } else {
+            report("unable to encode atlas page %zu of `%s`", i,
+                wad->entry->name);
+        }
+
+        release(pixel_data);
+        release_memory(worker, 2 * size);
+    }
+
+    write_atlas_sidecar(worker, wad, data, number_of_rects,
+        (atlas_page_t const *) pages.data, number_of_pages,
+        encoder->extension);
+
+    free_buffer(&pages);
+}
+
+static void process_wad_archive(worker_t *worker, wad_t *wad)
+{
+    NME_ASSERT(wad != NULL && wad->entry != NULL && wad->archive != NULL);
+
+    archive_t const *archive = wad->archive;
+
+    size_t cursor = wad->entry->offset;
+
+    if (read_wad_information(archive, wad, &cursor) == NME_FALSE) {
+        return;
+    }
+
+    add_to_statistic(&NME_STATISTICS.wads_parsed, 1);
+
+    arena_t *arena = &worker->arena;
+
+    wad->colors = expand_palettes(arena, wad->palettes,
+        wad->number_of_palettes);
+
+    wad->path = get_path_for_wad(arena, wad);
+    atomic_init(&wad->descriptor, NME_UNOPENED_DESCRIPTOR);
+
+    char *path = NULL;
+    size_t length = 0;
+
+    int is_filtered = NME_FALSE;
+
+    if (NME_SELECTION_PATTERNS.size != 0 || archive->manifest != NULL) {
+        path = get_archive_path_for_entry(arena, wad->entry,
+            NME_MAXIMUM_NAME_LENGTH + 1);
+
+        is_filtered = (NME_SELECTION_PATTERNS.size != 0 &&
+            is_path_selected(path, NME_FALSE) == NME_FALSE);
+
+        length = strlen(path);
+        path[length++] = NME_PATH_SEPARATOR;
+    }
+
+    buffer_t rects;
+    memset(&rects, 0x00, sizeof (buffer_t));
+
+    arena_mark_t mark = mark_arena(arena);
+
+    for (uint32_t i = 0; i < wad->number_of_images; ++i) {
+        image_t image;
+
+        memset(&image, 0x00, sizeof (image_t));
+        image.parent = wad;
+
+        read_image(archive, &image, &cursor);
+
+        if (path != NULL) {
+            strcpy(path + length, image.name);
+
+            if (is_filtered == NME_TRUE &&
+                is_path_selected(path, NME_FALSE) == NME_FALSE) {
+                continue;
+            }
+        }
+
+        if (NME_VERBOSITY != NME_SILENT) {
+            print_image_information(&image);
+        }
+
+        if (NME_ATLAS_SIZE != 0) {
+            collect_atlas_rect(&rects, &image, i);
+            continue;
+        }
+
+        if (archive->manifest != NULL &&
+            skip_unchanged_image(worker, &image, path) == NME_TRUE) {
+            rewind_arena(arena, mark);
+            continue;
+        }
+
+        duplicate_t source;
+        char *output_path = NULL;
+
+        if (NME_DEDUPLICATOR != NULL) {
+            char const *extension = NULL;
+            select_image_encoder(&image, &extension);
+
+            output_path = get_path_for_image(arena, &image, extension);
+            describe_image_source(&source, &image);
+
+            if (link_duplicate_output(&source, output_path,
+                &NME_STATISTICS.images_deduplicated) == NME_TRUE) {
+                rewind_arena(arena, mark);
+                continue;
+            }
+        }
+
+        size_t reservation = estimate_image_memory(&image);
+        acquire_memory(worker->pool, reservation);
+
+        if (has_extension(image.name, "rle") == NME_TRUE) {
+            extract_rle_image(worker, &image);
+        } else {
+            extract_bmp_image(worker, &image);
+        }
+
+        release_memory(worker, reservation);
+
+        if (output_path != NULL && get_file_size(output_path) >= 0) {
+            remember_duplicate(&source, output_path);
+        }
+
+        rewind_arena(arena, mark);
+    }
+
+    if (rects.size != 0) {
+        write_atlas(worker, wad, &rects);
+    }
+
+    free_buffer(&rects);
+
+#if defined (NME_POSIX)
+    close_directory(&wad->descriptor);
+#endif
+
+    add_to_statistic(&NME_STATISTICS.bytes_read, cursor - wad->entry->offset);
+}
+
+static entry_t *read_entry_information(archive_t const *archive,
+    entry_t *entry, size_t *cursor)
+{
+    NME_ASSERT(entry != NULL);
+
+    read_from_input(archive, entry, cursor, offsetof (entry_t, parent));
+
+    entry->name[31] = '\0';
+    return entry;
+}
+
+static void extract_entry_contents(worker_t *worker, entry_t const *entry)
+{
+    NME_ASSERT(entry != NULL && entry->type == NME_FILE);
+
+    if (entry->parent->archive->output_path == NULL || entry->size == 0) {
+        return;
+    }
+
+    if (has_extension(entry->name, "wad") == NME_TRUE) {
+        wad_t wad;
+
+        memset(&wad, 0x00, sizeof (wad_t));
+
+        wad.archive = entry->parent->archive;
+        wad.entry = entry;
+
+        process_wad_archive(worker, &wad);
+    } else {
+        char *path = get_path_for_entry(&worker->arena, entry);
+
+        if (entry->parent->archive->manifest != NULL &&
+            skip_unchanged_entry(worker, entry, path) == NME_TRUE) {
+            return;
+        }
+
+        duplicate_t source;
+
+        if (NME_DEDUPLICATOR != NULL) {
+            describe_entry_source(&source, entry);
+
+            if (link_duplicate_output(&source, path,
+                &NME_STATISTICS.files_deduplicated) == NME_TRUE) {
+                return;
+            }
+        }
+
+        create_directory_for_file(path);
+        extract_file_subsection(entry, path);
+
+        if (NME_DEDUPLICATOR != NULL) {
+            remember_duplicate(&source, path);
+        }
+    }
+}
+
+static void print_entry_information(entry_t const *entry)
+{
+    NME_ASSERT(entry != NULL);
+
+    if (NME_VERBOSITY == NME_SILENT || entry->type == NME_END_OF_DIRECTORY) {
+        return;
+    }
+
+    printf("[%s %u %u] ", entry->name, entry->offset, entry->size);
+}
+
+static size_t count_directory_entries(archive_t const *archive,
+    size_t offset)
+{
+    size_t count = 0;
+
+    for (;; offset += offsetof (entry_t, parent), ++count) {
+        entry_t const *entry = view_input(archive, offset,
+            offsetof (entry_t, parent));
+
+        if (entry->type == NME_END_OF_DIRECTORY) {
+            return count;
+        }
+    }
+}
+
+static void claim_directory_listing(string_set_t *listings, size_t offset)
+{
+    char key[32];
+    int length = snprintf(key, sizeof (key), "%zx", offset);
+
+    if (insert_new_string(listings, key, (size_t) length) == NME_FALSE) {
+        die("corrupt entry");
+    }
+}
+
+static void expand_directory(worker_t *worker, archive_t const *archive,
+    entry_t const *directory)
+{
+    NME_ASSERT(worker != NULL && archive != NULL);
+
+    pool_t *pool = worker->pool;
+    size_t cursor = (directory != NULL) ? directory->offset : 0;
+
+    claim_directory_listing(archive->expanded_directories, cursor);
+
+    size_t number_of_entries = count_directory_entries(archive, cursor);
+
+    char const *parent_path = "";
+    size_t parent_length = 0;
+    size_t length = 0;
+
+    if (directory != NULL) {
+        parent_path = directory->parent->path;
+        parent_length = strlen(parent_path);
+
+        length = parent_length + (parent_length != 0) +
+            strlen(directory->name);
+    }
+
+    listing_t *listing = allocate(sizeof (listing_t) +
+        sizeof (entry_t) * number_of_entries + length + 1);
+
+    char *path = (char *) &listing->entries[number_of_entries];
+
+    if (directory != NULL) {
+        memcpy(path, parent_path, parent_length);
+
+        if (parent_length != 0) {
+            path[parent_length++] = NME_PATH_SEPARATOR;
+        }
+
+        strcpy(path + parent_length, directory->name);
+    }
+
+    listing->archive = archive;
+    listing->path = path;
+    atomic_init(&listing->descriptor, NME_UNOPENED_DESCRIPTOR);
+
+    listing->number_of_entries = number_of_entries;
+
+    add_to_statistic(&NME_STATISTICS.directories_expanded, 1);
+    add_to_statistic(&NME_STATISTICS.bytes_read, offsetof (entry_t, parent) *
+        (number_of_entries + 1));
+
+    listing->next = worker->listings;
+    worker->listings = listing;
+
+    if (number_of_entries == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < number_of_entries; ++i) {
+        entry_t *entry = &listing->entries[i];
+
+        read_entry_information(archive, entry, &cursor);
+        entry->parent = listing;
+
+        if (is_entry_selected(&worker->arena, entry) == NME_FALSE) {
+            continue;
+        }
+
+        atomic_fetch_add(&pool->pending, 1);
+        atomic_fetch_add(&pool->queued, 1);
+
+        enqueue(worker->queue, entry);
+    }
+
+    if (atomic_load(&pool->idle) != 0) {
+        lock_mutex(&pool->mutex);
+        broadcast_condition(&pool->condition);
+        unlock_mutex(&pool->mutex);
+    }
+}
+
+static void process_entry(worker_t *worker, entry_t const *entry)
+{
+    NME_ASSERT(worker != NULL && entry != NULL);
+
+    switch (entry->type) {
+    case NME_FILE:
+        extract_entry_contents(worker, entry);
+        break;
+
+    case NME_DIRECTORY:
+        expand_directory(worker, entry->parent->archive, entry);
+        break;
+
+    default:
+        die("corrupt entry");
+        break;
+    }
+
+    if (NME_VERBOSITY != NME_SILENT) {
+        print_entry_information(entry);
+    }
+
+    add_to_statistic(&NME_STATISTICS.entries_walked, 1);
+    reset_arena(&worker->arena);
+}
+
+static entry_t const *acquire_entry(worker_t *worker)
+{
+    NME_ASSERT(worker != NULL);
+
+    pool_t *pool = worker->pool;
+    entry_t const *entry = dequeue(worker->queue);
+
+    for (size_t i = 1; entry == NULL && i < pool->number_of_workers; ++i) {
+        size_t victim = (worker->identifier + i) % pool->number_of_workers;
+        entry = steal(pool->workers[victim].queue);
+    }
+
+    if (entry != NULL) {
+        atomic_fetch_sub(&pool->queued, 1);
+    }
+
+    return entry;
+}
+
+static int wait_for_entries(pool_t *pool)
+{
+    NME_ASSERT(pool != NULL);
+
+    lock_mutex(&pool->mutex);
+    atomic_fetch_add(&pool->idle, 1);
+
+    while (atomic_load(&pool->queued) == 0 &&
+        atomic_load(&pool->pending) != 0) {
+        wait_for_condition(&pool->condition, &pool->mutex);
+    }
+
+    atomic_fetch_sub(&pool->idle, 1);
+    int has_pending_entries = (atomic_load(&pool->pending) != 0);
+
+    unlock_mutex(&pool->mutex);
+    return has_pending_entries;
+}
+
+static void *run_worker(void *argument)
+{
+    worker_t *worker = argument;
+    pool_t *pool = worker->pool;
+
+    for (;;) {
+        entry_t const *entry = acquire_entry(worker);
+
+        if (entry == NULL) {
+            if (wait_for_entries(pool) == NME_FALSE) {
+                break;
+            }
+
+            continue;
+        }
+
+        process_entry(worker, entry);
+
+        if (atomic_fetch_sub(&pool->pending, 1) == 1) {
+            lock_mutex(&pool->mutex);
+            broadcast_condition(&pool->condition);
+            unlock_mutex(&pool->mutex);
+        }
+    }
+
+    return NULL;
+}
+
+static pool_t *create_pool(size_t number_of_workers)
+{
+    NME_ASSERT(number_of_workers >= 1);
+
+    pool_t *pool = allocate(sizeof (pool_t));
+
+    pool->number_of_workers = number_of_workers;
+    pool->workers = allocate(sizeof (worker_t) * number_of_workers);
+
+    for (size_t i = 0; i < number_of_workers; ++i) {
+        worker_t *worker = &pool->workers[i];
+
+        worker->identifier = i;
+        worker->queue = create_queue(NME_QUEUE_CAPACITY);
+        worker->pool = pool;
+    }
+
+    atomic_init(&pool->queued, 0);
+    atomic_init(&pool->pending, 0);
+    atomic_init(&pool->idle, 0);
+
+    create_mutex(&pool->mutex);
+    create_condition(&pool->condition);
+
+    create_mutex(&pool->memory_mutex);
+    create_condition(&pool->memory_condition);
+
+    return pool;
+}
+
+static void free_pool(pool_t *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < pool->number_of_workers; ++i) {
+        worker_t *worker = &pool->workers[i];
+
+        while (worker->listings != NULL) {
+            listing_t *next = worker->listings->next;
+
+#if defined (NME_POSIX)
+            close_directory(&worker->listings->descriptor);
+#endif
+
+            release(worker->listings);
+            worker->listings = next;
+        }
+
+        free_arena(&worker->arena);
+        free_buffer(&worker->pixels);
+        free_buffer(&worker->scanlines);
+        free_buffer(&worker->encoded);
+
+        free_queue(worker->queue);
+    }
+
+    free_condition(&pool->memory_condition);
+    free_mutex(&pool->memory_mutex);
+
+    free_condition(&pool->condition);
+    free_mutex(&pool->mutex);
+
+    release(pool->workers);
+    release(pool);
+}
+
+static void run_pool(pool_t *pool)
+{
+    NME_ASSERT(pool != NULL && pool->number_of_workers >= 1);
+
+#if defined (NME_THREADS)
+    for (size_t i = 1; i < pool->number_of_workers; ++i) {
+        worker_t *worker = &pool->workers[i];
+
+        if (pthread_create(&worker->thread, NULL, run_worker, worker) != 0) {
+            die("pthread_create() failed");
+        }
+    }
+#endif
+
+    run_worker(&pool->workers[0]);
+
+#if defined (NME_THREADS)
+    for (size_t i = 1; i < pool->number_of_workers; ++i) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+#endif
+}
+
+static uint32_t append_path(buffer_t *strings, uint32_t prefix,
+    char const *name)
+{
+    NME_ASSERT(strings != NULL && name != NULL);
+
+    size_t prefix_length = 0;
+    size_t name_length = strlen(name);
+
+    if (prefix != NME_INDEX_ROOT) {
+        prefix_length = strlen((char const *) strings->data + prefix) + 1;
+    }
+
+    if (strings->size + prefix_length + name_length + 1 > UINT32_MAX) {
+        die("index string table overflow");
+    }
+
+    uint32_t offset = (uint32_t) strings->size;
+    char *path = append_to_buffer(strings, NULL, prefix_length +
+        name_length + 1);
+
+    if (prefix_length != 0) {
+        memcpy(path, strings->data + prefix, prefix_length - 1);
+        path[prefix_length - 1] = NME_PATH_SEPARATOR;
+    }
+
+    memcpy(path + prefix_length, name, name_length + 1);
+    return offset;
+}
+
+static void index_directory(archive_t const *archive, buffer_t *entries,
+    buffer_t *strings, string_set_t *listings, uint32_t parent)
+{
+    NME_ASSERT(entries != NULL && strings != NULL && listings != NULL);
+
+    index_entry_t *directory = NULL;
+    size_t cursor = 0;
+
+    if (parent != NME_INDEX_ROOT) {
+        directory = (index_entry_t *) entries->data + parent;
+        cursor = directory->offset;
+    }
+
+    claim_directory_listing(listings, cursor);
+
+    size_t number_of_entries = count_directory_entries(archive, cursor);
+    size_t first = entries->size / sizeof (index_entry_t);
+
+    if (first + number_of_entries >= UINT32_MAX) {
+        die("too many entries to index");
+    }
+
+    if (directory != NULL) {
+        directory->first = (uint32_t) first;
+        directory->count = (uint32_t) number_of_entries;
+    }
+
+    for (size_t i = 0; i < number_of_entries; ++i) {
+        entry_t entry;
+        index_entry_t record;
+
+        read_entry_information(archive, &entry, &cursor);
+        memset(&record, 0x00, sizeof (index_entry_t));
+
+        uint32_t prefix = NME_INDEX_ROOT;
+
+        if (parent != NME_INDEX_ROOT) {
+            prefix = ((index_entry_t *) entries->data)[parent].path;
+        }
+
+        record.path = append_path(strings, prefix, entry.name);
+        record.parent = parent;
+
+        record.offset = entry.offset;
+        record.size = entry.size;
+
+        record.type = entry.type;
+
+        append_to_buffer(entries, &record, sizeof (index_entry_t));
+    }
+}
+
+static void index_wad_images(archive_t const *archive, buffer_t *entries,
+    buffer_t *images, buffer_t *strings, uint32_t parent)
+{
+    NME_ASSERT(entries != NULL && images != NULL && strings != NULL);
+
+    index_entry_t *entry = (index_entry_t *) entries->data + parent;
+    size_t cursor = entry->offset;
+
+    wad_t wad;
+    memset(&wad, 0x00, sizeof (wad_t));
+
+    if (read_wad_information(archive, &wad, &cursor) == NME_FALSE) {
+        return;
+    }
+
+    size_t first = images->size / sizeof (index_image_t);
+
+    if (first + wad.number_of_images >= UINT32_MAX) {
+        die("too many images to index");
+    }
+
+    entry->first = (uint32_t) first;
+    entry->count = wad.number_of_images;
+
+    for (uint32_t i = 0; i < wad.number_of_images; ++i) {
+        image_t image;
+        index_image_t record;
+
+        memset(&image, 0x00, sizeof (image_t));
+        memset(&record, 0x00, sizeof (index_image_t));
+
+        record.header_offset = cursor;
+        skip_image(archive, &image, &cursor);
+
+        record.path = append_path(strings,
+            ((index_entry_t *) entries->data)[parent].path, image.name);
+        record.entry = parent;
+
+        record.pixel_data_offset = (uint64_t) (image.pixel_data -
+            archive->data);
+        record.pixel_data_size = image.pixel_data_size;
+
+        record.width = image.width;
+        record.height = image.height;
+
+        record.palette_id = image.palette_id;
+        record.color_depth = image.color_depth;
+
+        record.is_rle = (uint8_t) has_extension(image.name, "rle");
+
+        append_to_buffer(images, &record, sizeof (index_image_t));
+    }
+}
+
+static char const *get_index_string(index_t const *index, uint32_t offset)
+{
+    NME_ASSERT(index != NULL);
+
+    if (offset >= index->header->strings_size) {
+        die("invalid or corrupt index");
+    }
+
+    return index->strings + offset;
+}
+
+static uint32_t find_slot_in_index(index_t const *index, char const *path)
+{
+    NME_ASSERT(index != NULL && path != NULL);
+
+    uint32_t const number_of_entries = index->header->number_of_entries;
+    uint32_t const mask = index->header->number_of_slots - 1;
+
+    uint32_t slot = (uint32_t) hash_string(path, strlen(path)) & mask;
+
+    for (uint32_t i = 0; i <= mask; ++i, slot = (slot + 1) & mask) {
+        uint32_t value = index->slots[slot];
+
+        if (value == 0) {
+            return slot;
+        }
+
+        if (value > number_of_entries &&
+            value - number_of_entries > index->header->number_of_images) {
+            die("invalid or corrupt index");
+        }
+
+        uint32_t offset = (value <= number_of_entries) ?
+            index->entries[value - 1].path :
+            index->images[value - number_of_entries - 1].path;
+
+        if (strcmp(get_index_string(index, offset), path) == 0) {
+            return slot;
+        }
+    }
+
+    die("invalid or corrupt index");
+    return 0;
+}
+
+static index_t *assemble_index(archive_t const *archive, buffer_t *entries,
+    buffer_t *images, buffer_t *strings)
+{
+    size_t number_of_entries = entries->size / sizeof (index_entry_t);
+    size_t number_of_images = images->size / sizeof (index_image_t);
+
+    size_t number_of_slots = 16;
+
+    while (number_of_slots < (number_of_entries + number_of_images) << 1) {
+        number_of_slots <<= 1;
+    }
+
+    if (number_of_slots > UINT32_MAX) {
+        die("too many entries to index");
+    }
+
+    index_t *index = allocate(sizeof (index_t));
+
+    index->size = sizeof (index_header_t) + entries->size + images->size +
+        sizeof (uint32_t) * number_of_slots + strings->size;
+
+    uint8_t *data = allocate(index->size);
+    index_header_t *header = (index_header_t *) data;
+
+    memcpy(header->magic, NME_INDEX_MAGIC, sizeof (header->magic));
+    header->version = NME_INDEX_VERSION;
+
+    header->number_of_entries = (uint32_t) number_of_entries;
+    header->number_of_images = (uint32_t) number_of_images;
+    header->number_of_slots = (uint32_t) number_of_slots;
+
+    header->archive_size = archive->size;
+    header->archive_modification_time = archive->modification_time;
+
+    header->strings_size = strings->size;
+
+    uint8_t *cursor = data + sizeof (index_header_t);
+
+    index->header = header;
+    index->entries = memcpy(cursor, entries->data, entries->size);
+
+    cursor += entries->size;
+    index->images = memcpy(cursor, images->data, images->size);
+
+    cursor += images->size;
+    index->slots = (uint32_t const *) cursor;
+
+    cursor += sizeof (uint32_t) * number_of_slots;
+    index->strings = memcpy(cursor, strings->data, strings->size);
+
+    index->data = data;
+
+    uint32_t *slots = (uint32_t *) index->slots;
+
+    for (size_t i = 0; i < number_of_entries + number_of_images; ++i) {
+        uint32_t offset = (i < number_of_entries) ? index->entries[i].path :
+            index->images[i - number_of_entries].path;
+
+        uint32_t slot = find_slot_in_index(index, index->strings + offset);
+
+        if (slots[slot] == 0) {
+            slots[slot] = (uint32_t) i + 1;
+        }
+    }
+
+    return index;
+}
+
+static void collect_index(archive_t const *archive, buffer_t *entries,
+    buffer_t *images, buffer_t *strings, string_set_t *listings)
+{
+    index_directory(archive, entries, strings, listings, NME_INDEX_ROOT);
+
+    for (size_t i = 0; i < entries->size / sizeof (index_entry_t); ++i) {
+        index_entry_t const *entry = (index_entry_t const *) entries->data + i;
+        char const *path = (char const *) strings->data + entry->path;
+
+        if (entry->type == NME_DIRECTORY) {
+            index_directory(archive, entries, strings, listings,
+                (uint32_t) i);
+        } else if (entry->type == NME_FILE && entry->size != 0 &&
+            has_extension(path, "wad") == NME_TRUE) {
+            index_wad_images(archive, entries, images, strings, (uint32_t) i);
+        } else if (entry->type != NME_FILE) {
+            die("corrupt entry");
+        }
+    }
+}
+
+static index_t *build_index(archive_t const *archive)
+{
+    buffer_t entries, images, strings;
+
+    memset(&entries, 0x00, sizeof (buffer_t));
+    memset(&images, 0x00, sizeof (buffer_t));
+    memset(&strings, 0x00, sizeof (buffer_t));
+
+    string_set_t *listings = create_string_set(NME_STRING_SET_CAPACITY);
+    collect_index(archive, &entries, &images, &strings, listings);
+
+    index_t *index = assemble_index(archive, &entries, &images, &strings);
+
+    free_buffer(&entries);
+    free_buffer(&images);
+    free_buffer(&strings);
+
+    free_string_set(listings);
+
+    return index;
+}
+
+static index_t *load_index(archive_t const *archive, char const *filename)
+{
+    NME_ASSERT(archive != NULL && filename != NULL);
+
+    size_t size = 0;
+    void const *data = map_file(filename, &size, NULL, NULL);
+
+    if (data == NULL) {
+        return NULL;
+    }
+
+    index_header_t const *header = data;
+
+    if (size < sizeof (index_header_t) ||
+        memcmp(header->magic, NME_INDEX_MAGIC, sizeof (header->magic)) != 0 ||
+        header->version != NME_INDEX_VERSION ||
+        header->number_of_slots == 0 ||
+        (header->number_of_slots & (header->number_of_slots - 1)) != 0 ||
+        header->strings_size == 0 ||
+        size != sizeof (index_header_t) +
+            sizeof (index_entry_t) * (uint64_t) header->number_of_entries +
+            sizeof (index_image_t) * (uint64_t) header->number_of_images +
+            sizeof (uint32_t) * (uint64_t) header->number_of_slots +
+            header->strings_size) {
+        report("ignoring invalid index `%s`", filename);
+        unmap_file(data, size);
+
+        return NULL;
+    }
+
+    if (header->archive_size != archive->size ||
+        header->archive_modification_time != archive->modification_time) {
+        report("ignoring stale index `%s`", filename);
+        unmap_file(data, size);
+
+        return NULL;
+    }
+
+    index_t *index = allocate(sizeof (index_t));
+    uint8_t const *cursor = (uint8_t const *) data + sizeof (index_header_t);
+
+    index->header = header;
+    index->entries = (index_entry_t const *) cursor;
+
+    cursor += sizeof (index_entry_t) * header->number_of_entries;
+    index->images = (index_image_t const *) cursor;
+
+    cursor += sizeof (index_image_t) * header->number_of_images;
+    index->slots = (uint32_t const *) cursor;
+
+    cursor += sizeof (uint32_t) * header->number_of_slots;
+    index->strings = (char const *) cursor;
+
+    if (index->strings[header->strings_size - 1] != '\0') {
+        die("invalid or corrupt index");
+    }
+
+    index->data = data;
+    index->size = size;
+    index->is_mapped = NME_TRUE;
+
+    return index;
+}
+
+static void free_index(index_t *index)
+{
+    if (index == NULL) {
+        return;
+    }
+
+    if (index->is_mapped == NME_TRUE) {
+        unmap_file(index->data, index->size);
+    } else {
+        release((void *) index->data);
+    }
+
+    release(index);
+}
+
+static void list_index(index_t const *index)
+{
+    NME_ASSERT(index != NULL);
+
+    if (NME_VERBOSITY == NME_SILENT) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < index->header->number_of_entries; ++i) {
+        index_entry_t const *entry = &index->entries[i];
+
+        char const *path = get_index_string(index, entry->path);
+        char const *name = strrchr(path, NME_PATH_SEPARATOR);
+
+        int is_directory = (entry->type == NME_DIRECTORY ||
+            has_extension(path, "wad") == NME_TRUE);
+
+        if (is_path_selected(path, is_directory) == NME_FALSE) {
+            continue;
+        }
+
+        printf("[%s %u %u] ", (name != NULL) ? name + 1 : path,
+            entry->offset, entry->size);
+    }
+}
+
+static image_t const *find_wad_image(wad_t const *wad, char const *name)
+{
+    NME_ASSERT(wad != NULL && name != NULL);
+
+    for (uint32_t i = 0; i < wad->number_of_images; ++i) {
+        if (strcmp(wad->images[i].name, name) == 0) {
+            return &wad->images[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void set_lookup_entry(lookup_t *lookup, char const *name,
+    index_entry_t const *record)
+{
+    memset(&lookup->entry, 0x00, sizeof (entry_t));
+
+    strncpy(lookup->entry.name, name, sizeof (lookup->entry.name) - 1);
+    lookup->entry.type = record->type;
+
+    lookup->entry.size = record->size;
+    lookup->entry.offset = record->offset;
+}
+
+static int resolve_in_index(archive_t const *archive, index_t const *index,
+    char const *path, lookup_t *lookup)
+{
+    NME_ASSERT(index != NULL && path != NULL && lookup != NULL);
+
+    uint32_t const number_of_entries = index->header->number_of_entries;
+    uint32_t value = index->slots[find_slot_in_index(index, path)];
+
+    if (value == 0) {
+        return NME_FALSE;
+    }
+
+    uint32_t entry = value - 1;
+
+    if (value > number_of_entries) {
+        index_image_t const *record =
+            &index->images[value - number_of_entries - 1];
+        size_t cursor = record->header_offset;
+
+        skip_image(archive, &lookup->image, &cursor);
+
+        lookup->is_image = NME_TRUE;
+        entry = record->entry;
+    }
+
+    if (entry >= number_of_entries) {
+        die("invalid or corrupt index");
+    }
+
+    index_entry_t const *record = &index->entries[entry];
+
+    if (record->parent != NME_INDEX_ROOT &&
+        record->parent >= number_of_entries) {
+        die("invalid or corrupt index");
+    }
+
+    lookup->directory = "";
+
+    if (record->parent != NME_INDEX_ROOT) {
+        lookup->directory = get_index_string(index,
+            index->entries[record->parent].path);
+    }
+
+    char const *name = get_index_string(index, record->path);
+
+    if (*lookup->directory != '\0') {
+        name += strlen(lookup->directory) + 1;
+    }
+
+    set_lookup_entry(lookup, name, record);
+    return NME_TRUE;
+}
+
+static int resolve_in_archive(arena_t *arena, archive_t const *archive,
+    char const *path, lookup_t *lookup)
+{
+    NME_ASSERT(arena != NULL && path != NULL && lookup != NULL);
+
+    entry_t *entry = &lookup->entry;
+
+    char const *segment = path;
+    size_t cursor = 0;
+
+    for (;;) {
+        size_t const length = get_segment_length(segment);
+        size_t const number_of_entries = count_directory_entries(archive,
+            cursor);
+
+        size_t i = 0;
+
+        for (; i < number_of_entries; ++i) {
+            read_entry_information(archive, entry, &cursor);
+
+            if (strncmp(entry->name, segment, length) == 0 &&
+                entry->name[length] == '\0') {
+                break;
+            }
+        }
+
+        if (length == 0 || i == number_of_entries) {
+            return NME_FALSE;
+        }
+
+        if (segment[length] == '\0') {
+            break;
+        }
+
+        if (entry->type != NME_DIRECTORY) {
+            break;
+        }
+
+        cursor = entry->offset;
+        segment += length + 1;
+    }
+
+    size_t const length = (size_t) (segment - path);
+    char *directory = allocate_from_arena(arena, length + 1);
+
+    memcpy(directory, path, length);
+    directory[(length != 0) ? length - 1 : 0] = '\0';
+
+    lookup->directory = directory;
+
+    char const *name = segment + get_segment_length(segment);
+
+    if (*name == '\0') {
+        return NME_TRUE;
+    }
+
+    ++name;
+
+    if (entry->type != NME_FILE || entry->size == 0 ||
+        has_extension(entry->name, "wad") == NME_FALSE ||
+        strchr(name, NME_PATH_SEPARATOR) != NULL) {
+        return NME_FALSE;
+    }
+
+    wad_t wad;
+    memset(&wad, 0x00, sizeof (wad_t));
+
+    wad.archive = archive;
+    cursor = entry->offset;
+
+    if (read_wad_information(archive, &wad, &cursor) == NME_FALSE) {
+        return NME_FALSE;
+    }
+
+    read_wad_table(arena, &wad, &cursor);
+    image_t const *image = find_wad_image(&wad, name);
+
+    if (image == NULL) {
+        return NME_FALSE;
+    }
+
+    lookup->image = *image;
+    lookup->image.parent = NULL;
+    lookup->is_image = NME_TRUE;
+
+    return NME_TRUE;
+}
+
+static void extract_wad_image(worker_t *worker, entry_t const *entry,
+    image_t *image)
+{
+    NME_ASSERT(worker != NULL && entry != NULL && image != NULL);
+
+    wad_t wad;
+    memset(&wad, 0x00, sizeof (wad_t));
+
+    wad.archive = entry->parent->archive;
+    wad.entry = entry;
+
+    size_t cursor = entry->offset;
+
+    if (read_wad_information(wad.archive, &wad, &cursor) == NME_FALSE ||
+        image->palette_id >= wad.number_of_palettes) {
+        report("corrupt image `%s`", image->name);
+        return;
+    }
+
+    wad.colors = expand_palettes(&worker->arena, wad.palettes,
+        wad.number_of_palettes);
+
+    wad.path = get_path_for_wad(&worker->arena, &wad);
+    atomic_init(&wad.descriptor, NME_UNOPENED_DESCRIPTOR);
+
+    image->parent = &wad;
+
+    if (has_extension(image->name, "rle") == NME_TRUE) {
+        extract_rle_image(worker, image);
+    } else {
+        extract_bmp_image(worker, image);
+    }
+
+    image->parent = NULL;
+
+#if defined (NME_POSIX)
+    close_directory(&wad.descriptor);
+#endif
+}
+
+static void extract_lookup(archive_t const *archive, lookup_t *lookup)
+{
+    NME_ASSERT(archive != NULL && lookup != NULL);
+
+    int const is_directory = (lookup->entry.type == NME_DIRECTORY);
+
+    pool_t *pool = create_pool((is_directory == NME_TRUE) ?
+        NME_NUMBER_OF_WORKERS : 1);
+    worker_t *worker = &pool->workers[0];
+
+    size_t const length = strlen(lookup->directory);
+
+    listing_t *listing = allocate(sizeof (listing_t) + sizeof (entry_t) +
+        length + 1);
+    char *path = (char *) &listing->entries[1];
+
+    listing->archive = archive;
+    listing->path = memcpy(path, lookup->directory, length + 1);
+    atomic_init(&listing->descriptor, NME_UNOPENED_DESCRIPTOR);
+
+    listing->number_of_entries = 1;
+
+    listing->next = worker->listings;
+    worker->listings = listing;
+
+    entry_t *entry = memcpy(&listing->entries[0], &lookup->entry,
+        sizeof (entry_t));
+    entry->parent = listing;
+
+    if (is_directory == NME_TRUE) {
+        expand_directory(worker, archive, entry);
+        run_pool(pool);
+    } else if (lookup->is_image == NME_TRUE) {
+        extract_wad_image(worker, entry, &lookup->image);
+    } else {
+        extract_entry_contents(worker, entry);
+    }
+
+    free_pool(pool);
+}
+
+static void look_up_in_archive(archive_t const *archive,
+    index_t const *index, char const *path)
+{
+    NME_ASSERT(archive != NULL && path != NULL);
+
+    arena_t arena;
+    lookup_t lookup;
+
+    memset(&arena, 0x00, sizeof (arena_t));
+    memset(&lookup, 0x00, sizeof (lookup_t));
+
+    int is_found = (index != NULL) ?
+        resolve_in_index(archive, index, path, &lookup) :
+        resolve_in_archive(&arena, archive, path, &lookup);
+
+    if (is_found == NME_FALSE) {
+        fail("no entry named `%s`", path);
+    }
+
+    if (archive->output_path == NULL || NME_VERBOSITY != NME_SILENT) {
+        image_t const *image = &lookup.image;
+
+        if (lookup.is_image == NME_FALSE) {
+            printf("[%s %u %u]\n", path, lookup.entry.offset,
+                lookup.entry.size);
+        } else {
+            printf("{$ %s # %llu w %u h %u @ %u ~ %u}\n", path,
+                (unsigned long long) image->pixel_data_size, image->width,
+                image->height, image->color_depth, image->palette_id);
+        }
+    }
+
+    if (archive->output_path != NULL) {
+        extract_lookup(archive, &lookup);
+    }
+
+    free_arena(&arena);
+}
+
+static char *get_index_filename(archive_t const *archive)
+{
+    NME_ASSERT(archive != NULL && archive->filename != NULL);
+
+    if (NME_INDEX_FILENAME != NULL) {
+        char *filename = allocate(strlen(NME_INDEX_FILENAME) + 1);
+        return strcpy(filename, NME_INDEX_FILENAME);
+    }
+
+    char *filename = allocate(strlen(archive->filename) + 5);
+    return strcat(strcpy(filename, archive->filename), ".idx");
+}
+
+static char *get_output_path(archive_t const *archive,
+    size_t number_of_archives)
+{
+    NME_ASSERT(archive != NULL && archive->filename != NULL);
+
+    if (NME_OUTPUT_PATH == NULL) {
+        return NULL;
+    }
+
+    if (number_of_archives == 1) {
+        char *path = allocate(strlen(NME_OUTPUT_PATH) + 1);
+        return strcpy(path, NME_OUTPUT_PATH);
+    }
+
+    char const *name = archive->filename;
+
+    for (char const *cursor = name; *cursor != '\0'; ++cursor) {
+        if (is_path_separator(*cursor) == NME_TRUE) {
+            name = cursor + 1;
+        }
+    }
+
+    char const *extension = strrchr(name, '.');
+
+    size_t length = (extension != NULL && extension != name) ?
+        (size_t) (extension - name) : strlen(name);
+
+    size_t prefix_length = strlen(NME_OUTPUT_PATH);
+    char *path = allocate(prefix_length + length + 2);
+
+    memcpy(path, NME_OUTPUT_PATH, prefix_length);
+    path[prefix_length] = NME_PATH_SEPARATOR;
+
+    memcpy(path + prefix_length + 1, name, length);
+    path[prefix_length + length + 1] = '\0';
+
+    return path;
+}
+
+static int process_index(archive_t const *archive)
+{
+    NME_ASSERT(archive != NULL);
+
+    char *index_filename = get_index_filename(archive);
+    index_t *index = NULL;
+
+    int is_walk_required = NME_FALSE;
+
+    if (NME_BUILD_INDEX == NME_TRUE) {
+        index = build_index(archive);
+        dump_to_file(index_filename, index->data, index->size);
+    } else if (NME_OUTPUT_PATH == NULL || NME_LOOKUP_PATH != NULL) {
+        index = load_index(archive, index_filename);
+    }
+
+    if (NME_LOOKUP_PATH != NULL) {
+        look_up_in_archive(archive, index, NME_LOOKUP_PATH);
+    } else if (NME_OUTPUT_PATH == NULL && index != NULL) {
+        list_index(index);
+    } else if (NME_OUTPUT_PATH != NULL || NME_BUILD_INDEX == NME_FALSE) {
+        is_walk_required = NME_TRUE;
+    }
+
+    free_index(index);
+    release(index_filename);
+
+    return is_walk_required;
+}
+
+static void print_statistics(size_t number_of_archives)
+{
+    FILE *file = stdout;
+
+    if (NME_STATISTICS_FILENAME != NULL) {
+        file = fopen(NME_STATISTICS_FILENAME, "w");
+
+        if (file == NULL) {
+            report("unable to write statistics to `%s`",
+                NME_STATISTICS_FILENAME);
+            return;
+        }
+    }
+
+    statistics_t *statistics = &NME_STATISTICS;
+
+    fprintf(file,
+        "{\n"
+        "  \"version\": \"%s\",\n"
+        "  \"archives\": %zu,\n"
+        "  \"workers\": %zu,\n"
+        "  \"stages\": {\n"
+        "    \"open\": %.6f,\n"
+        "    \"index\": %.6f,\n"
+        "    \"extract\": %.6f,\n"
+        "    \"total\": %.6f\n"
+        "  },\n"
+        "  \"threads\": {\n"
+        "    \"io\": %.6f,\n"
+        "    \"decode\": %.6f,\n"
+        "    \"encode\": %.6f\n"
+        "  },\n"
+        "  \"counters\": {\n"
+        "    \"bytes_read\": %zu,\n"
+        "    \"entries_walked\": %zu,\n"
+        "    \"directories_expanded\": %zu,\n"
+        "    \"wads_parsed\": %zu,\n"
+        "    \"bmp_images_decoded\": %zu,\n"
+        "    \"rle_images_decoded\": %zu,\n"
+        "    \"bytes_encoded\": %zu,\n"
+        "    \"files_written\": %zu,\n"
+        "    \"bytes_written\": %zu,\n"
+        "    \"directories_created\": %zu,\n"
+        "    \"files_skipped\": %zu,\n"
+        "    \"images_skipped\": %zu,\n"
+        "    \"images_indexed\": %zu,\n"
+        "    \"files_deduplicated\": %zu,\n"
+        "    \"images_deduplicated\": %zu,\n"
+        "    \"bytes_deduplicated\": %zu,\n"
+        "    \"memory_waits\": %zu,\n"
+        "    \"peak_heap_bytes\": %zu\n"
+        "  }\n"
+        "}\n",
+        NME_VERSION_STRING, number_of_archives, NME_NUMBER_OF_WORKERS,
+        statistics->open_time * 1e-9, statistics->index_time * 1e-9,
+        statistics->extract_time * 1e-9, statistics->total_time * 1e-9,
+        atomic_load(&statistics->io_time) * 1e-9,
+        atomic_load(&statistics->decode_time) * 1e-9,
+        atomic_load(&statistics->encode_time) * 1e-9,
+        atomic_load(&statistics->bytes_read),
+        atomic_load(&statistics->entries_walked),
+        atomic_load(&statistics->directories_expanded),
+        atomic_load(&statistics->wads_parsed),
+        atomic_load(&statistics->bmp_images_decoded),
+        atomic_load(&statistics->rle_images_decoded),
+        atomic_load(&statistics->bytes_encoded),
+        atomic_load(&statistics->files_written),
+        atomic_load(&statistics->bytes_written),
+        atomic_load(&statistics->directories_created),
+        atomic_load(&statistics->files_skipped),
+        atomic_load(&statistics->images_skipped),
+        atomic_load(&statistics->images_indexed),
+        atomic_load(&statistics->files_deduplicated),
+        atomic_load(&statistics->images_deduplicated),
+        atomic_load(&statistics->bytes_deduplicated),
+        atomic_load(&statistics->memory_waits),
+        atomic_load(&NME_MAXIMUM_HEAP_USAGE));
+
+    if (file != stdout) {
+        fclose(file);
+    }
+}
+
+static int process_dir_archives(void)
+{
+    uint64_t start = start_timer();
+
+    char const **filenames = (char const **) NME_INPUT_FILENAMES.data;
+    size_t number_of_archives = NME_INPUT_FILENAMES.size /
+        sizeof (char const *);
+
+    select_row_converters();
+    create_encoder_tables();
+    NME_CREATED_DIRECTORIES = create_string_set(NME_STRING_SET_CAPACITY);
+
+    if (NME_DEDUPLICATION != NME_FALSE) {
+        NME_DEDUPLICATOR = create_deduplicator();
+    }
+
+    if (NME_TAR_FILENAME != NULL) {
+        NME_TAR_STREAM = open_tar_stream(NME_TAR_FILENAME);
+    }
+
+    if (NME_ASYNC_IO != NME_FALSE) {
+        NME_WRITER = create_writer(NME_ASYNC_IO == NME_ASYNC_IO_RING);
+    }
+
+    archive_t *archives = allocate(sizeof (archive_t) * number_of_archives);
+    pool_t *pool = NULL;
+
+    for (size_t i = 0; i < number_of_archives; ++i) {
+        archive_t *archive = &archives[i];
+
+        archive->filename = filenames[i];
+        archive->output_path = get_output_path(archive, number_of_archives);
+
+        for (size_t k = 0; k < i && archive->output_path != NULL; ++k) {
+            if (strcmp(archives[k].output_path, archive->output_path) == 0) {
+                fail("`%s` and `%s` would both extract to `%s`",
+                    archives[k].filename, archive->filename,
+                    archive->output_path);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < number_of_archives; ++i) {
+        archive_t *archive = &archives[i];
+        uint64_t stage = start_timer();
+        map_input_file(archive);
+
+        archive->expanded_directories = create_string_set(
+            NME_STRING_SET_CAPACITY);
+
+        NME_STATISTICS.open_time += start_timer() - stage;
+        stage = start_timer();
+
+        int is_walk_required = process_index(archive);
+        NME_STATISTICS.index_time += start_timer() - stage;
+
+        if (is_walk_required == NME_FALSE) {
+            continue;
+        }
+
+        if (NME_INCREMENTAL == NME_TRUE && archive->output_path != NULL) {
+            archive->manifest = load_manifest(archive);
+        }
+
+        if (pool == NULL) {
+            pool = create_pool(NME_NUMBER_OF_WORKERS);
+        }
+
+        expand_directory(&pool->workers[i % pool->number_of_workers],
+            archive, NULL);
+    }
+
+    if (pool != NULL) {
+        uint64_t stage = start_timer();
+        run_pool(pool);
+
+        NME_STATISTICS.extract_time = start_timer() - stage;
+        free_pool(pool);
+    }
+
+    close_writer(NME_WRITER);
+    NME_WRITER = NULL;
+
+    close_tar_stream(NME_TAR_STREAM);
+    NME_TAR_STREAM = NULL;
+
+    for (size_t i = 0; i < number_of_archives; ++i) {
+        if (archives[i].manifest != NULL) {
+            save_manifest(&archives[i]);
+            free_manifest(archives[i].manifest);
+        }
+
+        free_string_set(archives[i].expanded_directories);
+        unmap_input_file(&archives[i]);
+        release(archives[i].output_path);
+    }
+
+    release(archives);
+    free_buffer(&NME_INPUT_FILENAMES);
+
+    free_buffer(&NME_SELECTION_PATTERNS);
+
+    free_string_set(NME_CREATED_DIRECTORIES);
+    NME_CREATED_DIRECTORIES = NULL;
+
+    if (NME_DEDUPLICATOR != NULL) {
+        report("deduplicated %zu files and %zu images, saving %zu bytes",
+            atomic_load(&NME_STATISTICS.files_deduplicated),
+            atomic_load(&NME_STATISTICS.images_deduplicated),
+            atomic_load(&NME_STATISTICS.bytes_deduplicated));
+
+        free_deduplicator(NME_DEDUPLICATOR);
+        NME_DEDUPLICATOR = NULL;
+    }
+
+    if (NME_COLLECT_STATISTICS == NME_TRUE) {
+        NME_STATISTICS.total_time = start_timer() - start;
+        print_statistics(number_of_archives);
+    }
+
+    if (NME_VERBOSITY != NME_SILENT) {
+        report("used %zu bytes of heap memory at peak",
+            atomic_load(&NME_MAXIMUM_HEAP_USAGE));
+
+        if (atomic_load(&NME_CURRENT_HEAP_USAGE) != 0) {
+            die("leaked %zu bytes of heap memory",
+                atomic_load(&NME_CURRENT_HEAP_USAGE));
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+#if defined (NME_POSIX)
+static int compare_names(void const *first, void const *second)
+{
+    return strcmp(*(char const *const *) first, *(char const *const *) second);
+}
+
+static size_t list_directory(arena_t *arena, char const *path,
+    buffer_t *names)
+{
+    NME_ASSERT(arena != NULL && path != NULL && names != NULL);
+
+    DIR *directory = opendir(path);
+
+    if (directory == NULL) {
+        die("unable to open directory `%s`", path);
+    }
+
+    names->size = 0;
+
+    for (struct dirent *item; (item = readdir(directory)) != NULL;) {
+        char const *name = item->d_name;
+
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0 ||
+            strcmp(name, NME_MANIFEST_NAME) == 0) {
+            continue;
+        }
+
+        if (strlen(name) >= NME_MAXIMUM_NAME_LENGTH) {
+            report("skipping `%s/%s`, names are limited to %zu characters",
+                path, name, NME_MAXIMUM_NAME_LENGTH - 1);
+
+            continue;
+        }
+
+        char *copy = join_paths(arena, name, NULL, NULL, 0);
+        append_to_buffer(names, &copy, sizeof (char *));
+    }
+
+    closedir(directory);
+
+    size_t const number_of_names = names->size / sizeof (char *);
+    qsort(names->data, number_of_names, sizeof (char *), compare_names);
+
+    return number_of_names;
+}
+
+static uint32_t read_little_endian(uint8_t const *source, size_t size)
+{
+    uint32_t value = 0;
+
+    for (size_t i = 0; i < size; ++i) {
+        value |= (uint32_t) source[i] << 8 * i;
+    }
+
+    return value;
+}
+
+static uint8_t *load_image_file(uint8_t const *data, size_t size,
+    size_t *width, size_t *height)
+{
+    if (size > INT_MAX) {
+        return NULL;
+    }
+
+    int columns = 0;
+    int rows = 0;
+    int channels = 0;
+
+    uint8_t *pixels = stbi_load_from_memory(data, (int) size, &columns,
+        &rows, &channels, 4);
+
+    *width = (size_t) columns;
+    *height = (size_t) rows;
+
+    return pixels;
+}
+
+static uint16_t pack_color(uint8_t red, uint8_t green, uint8_t blue)
+{
+    return (uint16_t) (((red * 31 + 127) / 255) << 11 |
+        ((green * 63 + 127) / 255) << 5 | ((blue * 31 + 127) / 255));
+}
+
+static void open_palette(wad_builder_t *builder)
+{
+    if (builder->palettes.size != 0) {
+        palette_t const *palette = (palette_t const *)
+            (builder->palettes.data + builder->palettes.size) - 1;
+
+        for (size_t i = 0; i < builder->number_of_colors; ++i) {
+            builder->slots[palette->colors[i]] = 0;
+        }
+    }
+
+    memset(append_to_buffer(&builder->palettes, NULL, sizeof (palette_t)),
+        0x00, sizeof (palette_t));
+
+    builder->number_of_colors = 0;
+}
+
+static size_t collect_new_colors(wad_builder_t *builder,
+    uint8_t const *pixels, size_t number_of_pixels, uint16_t *colors)
+{
+    size_t count = 0;
+    int has_overflowed = NME_FALSE;
+
+    for (size_t i = 0; i < number_of_pixels; ++i, pixels += 4) {
+        if (pixels[3] == 0) {
+            continue;
+        }
+
+        uint16_t const color = pack_color(pixels[0], pixels[1], pixels[2]);
+
+        if (builder->slots[color] != 0) {
+            continue;
+        }
+
+        if (count == 256) {
+            has_overflowed = NME_TRUE;
+            break;
+        }
+
+        builder->slots[color] = UINT16_MAX;
+        colors[count++] = color;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        builder->slots[colors[i]] = 0;
+    }
+
+    return (has_overflowed == NME_TRUE) ? SIZE_MAX : count;
+}
+
+static int assign_palette(wad_builder_t *builder, uint8_t const *pixels,
+    size_t number_of_pixels, uint8_t *indices, uint32_t *palette_id)
+{
+    uint16_t colors[256];
+    size_t count = collect_new_colors(builder, pixels, number_of_pixels,
+        colors);
+
+    if (count == SIZE_MAX) {
+        return NME_FALSE;
+    }
+
+    if (builder->palettes.size == 0 ||
+        count > 256 - builder->number_of_colors) {
+        open_palette(builder);
+        count = collect_new_colors(builder, pixels, number_of_pixels, colors);
+    }
+
+    if (count == SIZE_MAX) {
+        return NME_FALSE;
+    }
+
+    palette_t *palette = (palette_t *) (builder->palettes.data +
+        builder->palettes.size) - 1;
+
+    for (size_t i = 0; i < count; ++i) {
+        palette->colors[builder->number_of_colors] = colors[i];
+        builder->slots[colors[i]] = (uint16_t) ++builder->number_of_colors;
+    }
+
+    for (size_t i = 0; i < number_of_pixels; ++i, pixels += 4) {
+        indices[i] = (pixels[3] == 0) ? 0 : (uint8_t) (builder->slots[
+            pack_color(pixels[0], pixels[1], pixels[2])] - 1);
+    }
+
+    *palette_id = (uint32_t) (builder->palettes.size / sizeof (palette_t) -
+        1);
+
+    return NME_TRUE;
+}
+
+static size_t append_rle_run(buffer_t *images, uint8_t const *pixels,
+    uint8_t const *indices, size_t tracker, size_t end)
+{
+    uint8_t const alpha = pixels[4 * tracker + 3];
+    size_t const limit = (alpha == 255) ? 0xFD : 0xFF;
+
+    size_t count = 1;
+
+    while (count < limit && tracker + count < end) {
+        uint8_t const next = pixels[4 * (tracker + count) + 3];
+
+        if ((next == 0) != (alpha == 0) || (next == 255) != (alpha == 255)) {
+            break;
+        }
+
+        ++count;
+    }
+
+    uint8_t const run[2] = {
+        (alpha == 0) ? 0xFF : 0xFE, (uint8_t) count
+    };
+
+    if (alpha == 255) {
+        append_to_buffer(images, run + 1, 1);
+    } else {
+        append_to_buffer(images, run, 2);
+    }
+
+    if (alpha != 0) {
+        append_to_buffer(images, indices + tracker, count);
+    }
+
+    return tracker + count;
+}
+
+static void append_rle_pixel_data(buffer_t *images, uint8_t const *pixels,
+    uint8_t const *indices, size_t width, size_t height, uint32_t *offsets)
+{
+    size_t const start = images->size;
+    size_t end = width * height;
+
+    while (end > 0 && read_little_endian(pixels + 4 * (end - 1), 4) == 0) {
+        --end;
+    }
+
+    for (size_t y = 0; y < height; ++y) {
+        offsets[y] = (uint32_t) (images->size - start);
+
+        size_t tracker = width * y;
+        size_t const row_end = (tracker + width < end) ? tracker + width : end;
+
+        while (tracker < row_end) {
+            tracker = append_rle_run(images, pixels, indices, tracker,
+                row_end);
+        }
+    }
+}
+
+static int append_wad_image(wad_builder_t *builder, char const *name,
+    uint8_t const *data, size_t size)
+{
+    NME_ASSERT(builder != NULL && name != NULL && data != NULL);
+
+    size_t width = 0;
+    size_t height = 0;
+
+    uint8_t *pixels = NULL;
+    int is_rle = has_extension(name, "png");
+
+    if (is_rle == NME_TRUE || has_extension(name, "bmp") == NME_TRUE) {
+        pixels = load_image_file(data, size, &width, &height);
+    }
+
+    if (pixels == NULL) {
+        return NME_FALSE;
+    }
+
+    size_t const number_of_pixels = width * height;
+
+    for (size_t i = 0; i < number_of_pixels && is_rle == NME_FALSE; ++i) {
+        is_rle = (pixels[4 * i + 3] != 255);
+    }
+
+    uint8_t *indices = allocate_uninitialized(number_of_pixels);
+    uint32_t palette_id = 0;
+
+    if (assign_palette(builder, pixels, number_of_pixels, indices,
+        &palette_id) == NME_FALSE) {
+        release(indices);
+        stbi_image_free(pixels);
+
+        return NME_FALSE;
+    }
+
+    buffer_t *images = &builder->images;
+    size_t const start = images->size;
+
+    char *header = memset(append_to_buffer(images, NULL, 64), 0x00, 64);
+
+    strcpy(header, name);
+    strcpy(strrchr(header, '.') + 1, (is_rle == NME_TRUE) ? "rle" : "bmp");
+
+    uint32_t const dimensions[2] = { (uint32_t) height, (uint32_t) width };
+    uint16_t const color_depth = 8;
+
+    memcpy(header + 48, dimensions, sizeof (dimensions));
+    memcpy(header + 56, &color_depth, sizeof (uint16_t));
+
+    uint32_t *offsets = allocate(sizeof (uint32_t) * height);
+
+    if (is_rle == NME_TRUE) {
+        append_rle_pixel_data(images, pixels, indices, width, height,
+            offsets);
+    } else {
+        uint8_t *pixel_data = append_to_buffer(images, NULL,
+            (width + 2) * height);
+
+        for (size_t y = 0; y < height; ++y, pixel_data += width + 2) {
+            memcpy(pixel_data, indices + width * y, width);
+            memset(pixel_data + width, 0x00, 2);
+        }
+    }
+
+    uint64_t const pixel_data_size = images->size - start - 64;
+    memcpy(images->data + start + 32, &pixel_data_size, sizeof (uint64_t));
+
+    if (is_rle == NME_TRUE) {
+        uint32_t const data_block_size = (uint32_t) (sizeof (uint32_t) *
+            height);
+
+        append_to_buffer(images, &data_block_size, sizeof (uint32_t));
+        memset(append_to_buffer(images, NULL, 4), 0x00, 4);
+        append_to_buffer(images, dimensions + 1, sizeof (uint32_t));
+        append_to_buffer(images, dimensions, sizeof (uint32_t));
+        append_to_buffer(images, offsets, data_block_size);
+    }
+
+    append_to_buffer(images, &palette_id, sizeof (uint32_t));
+
+    release(offsets);
+    release(indices);
+    stbi_image_free(pixels);
+
+    return NME_TRUE;
+}
+
+static void build_wad(arena_t *arena, char const *path, buffer_t *wad)
+{
+    NME_ASSERT(arena != NULL && path != NULL && wad != NULL);
+
+    buffer_t names;
+    wad_builder_t builder;
+
+    memset(&names, 0x00, sizeof (buffer_t));
+    memset(&builder, 0x00, sizeof (wad_builder_t));
+
+    builder.slots = allocate(65536 * sizeof (uint16_t));
+
+    size_t const number_of_names = list_directory(arena, path, &names);
+    uint32_t number_of_images = 0;
+
+    for (size_t i = 0; i < number_of_names; ++i) {
+        char const *name = ((char **) names.data)[i];
+        char *filename = join_paths(arena, path, name, NULL, 0);
+
+        size_t size = 0;
+        void const *data = map_file(filename, &size, NULL, NULL);
+
+        if (data == NULL || append_wad_image(&builder, name, data,
+            size) == NME_FALSE) {
+            report("unable to convert `%s`, wad images must be bmp or png "
+                "files with at most 256 colors", filename);
+            atomic_fetch_add(&NME_STATISTICS.images_skipped, 1);
+        } else {
+            ++number_of_images;
+        }
+
+        unmap_file(data, size);
+    }
+
+    if (builder.palettes.size == 0) {
+        open_palette(&builder);
+    }
+
+    uint32_t number_of_palettes = (uint32_t) (builder.palettes.size /
+        sizeof (palette_t));
+
+    memset(append_to_buffer(wad, NULL, 400), 0x00, 400);
+
+    append_to_buffer(wad, &number_of_palettes, sizeof (uint32_t));
+    append_to_buffer(wad, builder.palettes.data, builder.palettes.size);
+
+    append_to_buffer(wad, &number_of_images, sizeof (uint32_t));
+    append_to_buffer(wad, builder.images.data, builder.images.size);
+
+    release(builder.slots);
+
+    free_buffer(&names);
+    free_buffer(&builder.images);
+    free_buffer(&builder.palettes);
+}
+
+static void write_at(int output, void const *data, size_t size,
+    size_t offset, char const *filename)
+{
+    if (lseek(output, (off_t) offset, SEEK_SET) == -1 ||
+        write_in_chunks(output, data, size) == NME_FALSE) {
+        die("unable to write `%s`", filename);
+    }
+}
+
+static void copy_file_into(int output, char const *path, size_t size,
+    size_t offset, char const *filename)
+{
+    int input = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (input == -1) {
+        die("unable to open `%s`", path);
+    }
+
+    if (lseek(output, (off_t) offset, SEEK_SET) == -1) {
+        die("unable to write `%s`", filename);
+    }
+
+    size_t copied = copy_with_kernel(output, input, 0, size);
+
+    if (copied < size) {
+        size_t mapped = 0;
+        uint8_t const *data = map_file(path, &mapped, NULL, NULL);
+
+        if (data == NULL || mapped < size || write_in_chunks(output,
+            data + copied, size - copied) == NME_FALSE) {
+            die("unable to write `%s`", filename);
+        }
+
+        unmap_file(data, mapped);
+    }
+
+    close(input);
+}
+
+static int mark_directory_visited(string_set_t *visited,
+    struct stat const *status)
+{
+    char key[64];
+    int length = snprintf(key, sizeof (key), "%llx:%llx",
+        (unsigned long long) status->st_dev,
+        (unsigned long long) status->st_ino);
+
+    if (find_string(visited, key, (size_t) length) != NULL) {
+        return NME_FALSE;
+    }
+
+    insert_string(visited, key, (size_t) length);
+    return NME_TRUE;
+}
+
+static size_t pack_directory(int output, pack_directory_t const *directory,
+    buffer_t *directories, string_set_t *visited, arena_t *arena,
+    size_t cursor, char const *filename)
+{
+    buffer_t names, entries, contents;
+
+    memset(&names, 0x00, sizeof (buffer_t));
+    memset(&entries, 0x00, sizeof (buffer_t));
+    memset(&contents, 0x00, sizeof (buffer_t));
+
+    size_t const number_of_names = list_directory(arena, directory->path,
+        &names);
+
+    for (size_t i = 0; i < number_of_names; ++i) {
+        char const *name = ((char **) names.data)[i];
+        char *path = join_paths(arena, directory->path, name, NULL, 0);
+
+        struct stat status;
+
+        if (stat(path, &status) != 0 ||
+            (S_ISDIR(status.st_mode) == 0 && S_ISREG(status.st_mode) == 0)) {
+            report("skipping `%s`, not a regular file or directory", path);
+            continue;
+        }
+
+        pack_entry_t pack_entry;
+        memset(&pack_entry, 0x00, sizeof (pack_entry_t));
+
+        entry_t *entry = &pack_entry.entry;
+
+        strcpy(entry->name, name);
+        entry->type = NME_FILE;
+
+        pack_entry.path = path;
+
+        if (S_ISREG(status.st_mode) != 0) {
+            if ((uint64_t) status.st_size > UINT32_MAX) {
+                die("`%s` is too large to pack", path);
+            }
+
+            entry->size = (uint32_t) status.st_size;
+        } else if (has_extension(name, "wad") == NME_TRUE) {
+            size_t start = contents.size;
+            build_wad(arena, path, &contents);
+
+            if (contents.size - start > UINT32_MAX) {
+                die("`%s` is too large to pack", path);
+            }
+
+            entry->size = (uint32_t) (contents.size - start);
+            pack_entry.is_built = NME_TRUE;
+        } else if (mark_directory_visited(visited, &status) == NME_TRUE) {
+            entry->type = NME_DIRECTORY;
+        } else {
+            report("skipping `%s`, directory is already packed", path);
+            continue;
+        }
+
+        append_to_buffer(&entries, &pack_entry, sizeof (pack_entry_t));
+    }
+
+    pack_entry_t *pack_entries = (pack_entry_t *) entries.data;
+    size_t const number_of_entries = entries.size / sizeof (pack_entry_t);
+
+    size_t const record_size = offsetof (entry_t, parent);
+    size_t const listing = cursor;
+
+    if (listing > UINT32_MAX) {
+        die("`%s` exceeds the 4 GiB archive limit", filename);
+    }
+
+    if (directory->reference != SIZE_MAX) {
+        uint32_t offset = (uint32_t) listing;
+        write_at(output, &offset, sizeof (uint32_t), directory->reference,
+            filename);
+    }
+
+    cursor += record_size * (number_of_entries + 1);
+
+    uint8_t *records = allocate(record_size * (number_of_entries + 1));
+    uint8_t const *built = contents.data;
+
+    for (size_t i = 0; i < number_of_entries; ++i) {
+        entry_t *entry = &pack_entries[i].entry;
+
+        if (entry->type == NME_DIRECTORY) {
+            pack_directory_t child = {
+                pack_entries[i].path, listing + record_size * i +
+                offsetof (entry_t, offset)
+            };
+
+            append_to_buffer(directories, &child, sizeof (pack_directory_t));
+        } else {
+            cursor = (cursor + NME_PACK_ALIGNMENT - 1) &
+                ~(NME_PACK_ALIGNMENT - 1);
+
+            if (cursor + entry->size > UINT32_MAX) {
+                die("`%s` exceeds the 4 GiB archive limit", filename);
+            }
+
+            entry->offset = (uint32_t) cursor;
+            cursor += entry->size;
+        }
+
+        memcpy(records + record_size * i, entry, record_size);
+    }
+
+    entry_t end;
+    memset(&end, 0x00, sizeof (entry_t));
+
+    end.type = NME_END_OF_DIRECTORY;
+    memcpy(records + record_size * number_of_entries, &end, record_size);
+
+    write_at(output, records, record_size * (number_of_entries + 1),
+        listing, filename);
+
+    for (size_t i = 0; i < number_of_entries; ++i) {
+        entry_t const *entry = &pack_entries[i].entry;
+
+        if (entry->type == NME_DIRECTORY) {
+            continue;
+        }
+
+        if (pack_entries[i].is_built == NME_TRUE) {
+            write_at(output, built, entry->size, entry->offset, filename);
+            built += entry->size;
+        } else if (entry->size != 0) {
+            copy_file_into(output, pack_entries[i].path, entry->size,
+                entry->offset, filename);
+        }
+    }
+
+    release(records);
+
+    free_buffer(&names);
+    free_buffer(&entries);
+    free_buffer(&contents);
+
+    return cursor;
+}
+
+static int pack_archive(char const *source, char const *filename)
+{
+    NME_ASSERT(source != NULL && filename != NULL);
+
+    struct stat information;
+
+    if (stat(source, &information) != 0 || !S_ISDIR(information.st_mode)) {
+        fail("unable to open directory `%s`", source);
+    }
+
+    uint64_t start = start_timer();
+
+    arena_t arena;
+    memset(&arena, 0x00, sizeof (arena_t));
+
+    char *temporary_filename = join_paths(&arena, filename, NULL, NULL, 4);
+    strcat(temporary_filename, ".tmp");
+
+    int output = open(temporary_filename, O_WRONLY | O_CREAT | O_TRUNC |
+        O_CLOEXEC, 0666);
+
+    if (output == -1) {
+        die("unable to open `%s`", temporary_filename);
+    }
+
+    buffer_t directories;
+    memset(&directories, 0x00, sizeof (buffer_t));
+
+    pack_directory_t root = {
+        join_paths(&arena, source, NULL, NULL, 0), SIZE_MAX
+    };
+
+    append_to_buffer(&directories, &root, sizeof (pack_directory_t));
+
+    string_set_t *visited = create_string_set(NME_STRING_SET_CAPACITY);
+    mark_directory_visited(visited, &information);
+
+    size_t cursor = 0;
+
+    for (size_t i = 0; i < directories.size / sizeof (pack_directory_t);
+        ++i) {
+        pack_directory_t directory = ((pack_directory_t *)
+            directories.data)[i];
+
+        cursor = pack_directory(output, &directory, &directories, visited,
+            &arena, cursor, filename);
+    }
+
+    free_string_set(visited);
+
+    size_t const failures = atomic_load(&NME_STATISTICS.images_skipped);
+
+    if (failures != 0) {
+        close(output);
+        unlink(temporary_filename);
+
+        fail("unable to pack `%s`, %zu images could not be converted",
+            filename, failures);
+    }
+
+    if (ftruncate(output, (off_t) cursor) != 0 || close(output) != 0 ||
+        rename(temporary_filename, filename) != 0) {
+        unlink(temporary_filename);
+        die("unable to write `%s`", filename);
+    }
+
+    stop_timer(&NME_STATISTICS.io_time, start);
+
+    add_to_statistic(&NME_STATISTICS.files_written, 1);
+    add_to_statistic(&NME_STATISTICS.bytes_written, cursor);
+
+    if (NME_VERBOSITY != NME_SILENT) {
+        printf("packed %zu directories into `%s` (%zu bytes)\n",
+            directories.size / sizeof (pack_directory_t), filename, cursor);
+    }
+
+    free_buffer(&directories);
+    free_arena(&arena);
+
+    return EXIT_SUCCESS;
+}
+#else
+static int pack_archive(char const *source, char const *filename)
+{
+    (void) source;
+    (void) filename;
+
+    fail("option `--pack` is not supported on this platform");
+    return EXIT_FAILURE;
+}
+#endif
+
+static void initialize_library(void)
+{
+#if defined (NME_THREADS)
+    pthread_once(&NME_LIBRARY_INITIALIZATION, select_row_converters);
+#else
+    if (NME_CONVERT_ROW_TO_RGBA == NULL) {
+        select_row_converters();
+    }
+#endif
+}
+
+static nme_status_t run_protected(void (*function)(void *), void *context)
+{
+    jmp_buf recovery_point;
+    jmp_buf *previous = NME_RECOVERY_POINT;
+
+    nme_status_t status = NME_OK;
+
+    if (setjmp(recovery_point) == 0) {
+        NME_RECOVERY_POINT = &recovery_point;
+        function(context);
+    } else {
+        status = NME_RECOVERY_STATUS;
+    }
+
+    NME_RECOVERY_POINT = previous;
+    return status;
+}
+
+static void open_archive_handle(void *context)
+{
+    library_call_t *call = context;
+    call->handle = allocate(sizeof (nme_archive_t));
+    archive_t *archive = &call->handle->archive;
+
+    archive->descriptor = -1;
+
+    if (call->filename != NULL) {
+        archive->filename = call->filename;
+        archive->data = map_file(call->filename, &archive->size,
+            &archive->modification_time, NULL);
+
+        if (archive->data == NULL) {
+            escape(NME_ERROR_OPEN);
+        }
+
+        call->handle->is_mapped = NME_TRUE;
+    } else {
+        archive->data = call->data;
+        archive->size = call->size;
+    }
+
+    call->listings = create_string_set(NME_STRING_SET_CAPACITY);
+
+    collect_index(archive, &call->entries, &call->images, &call->strings,
+        call->listings);
+
+    call->handle->index = assemble_index(archive, &call->entries,
+        &call->images, &call->strings);
+}
+
+static nme_status_t open_archive(library_call_t *call, nme_archive_t **archive)
+{
+    initialize_library();
+
+    nme_status_t status = run_protected(open_archive_handle, call);
+
+    free_buffer(&call->entries);
+    free_buffer(&call->images);
+    free_buffer(&call->strings);
+
+    free_string_set(call->listings);
+
+    if (status != NME_OK) {
+        nme_close(call->handle);
+        call->handle = NULL;
+    }
+
+    *archive = call->handle;
+    return status;
+}
+
+static uint32_t find_in_archive(nme_archive_t const *archive,
+    char const *path)
+{
+    return archive->index->slots[find_slot_in_index(archive->index, path)];
+}
+
+static void describe_entry(nme_archive_t const *archive, uint32_t value,
+    nme_entry_t *entry)
+{
+    index_t const *index = archive->index;
+    uint32_t const number_of_entries = index->header->number_of_entries;
+
+    memset(entry, 0x00, sizeof (nme_entry_t));
+
+    if (value <= number_of_entries) {
+        index_entry_t const *record = &index->entries[value - 1];
+
+        entry->path = get_index_string(index, record->path);
+        entry->type = (record->type == NME_DIRECTORY) ?
+            NME_ENTRY_DIRECTORY : NME_ENTRY_FILE;
+
+        entry->size = (record->type == NME_DIRECTORY) ? 0 : record->size;
+        return;
+    }
+
+    index_image_t const *record = &index->images[value - number_of_entries - 1];
+    uint64_t const number_of_pixels = (uint64_t) record->width * record->height;
+
+    entry->path = get_index_string(index, record->path);
+    entry->type = NME_ENTRY_IMAGE;
+
+    entry->size = (number_of_pixels > UINT64_MAX >> 2) ? UINT64_MAX :
+        number_of_pixels << 2;
+
+    entry->width = record->width;
+    entry->height = record->height;
+}
+
+static void decode_archive_image(void *context)
+{
+    library_call_t *call = context;
+
+    archive_t const *archive = &call->handle->archive;
+    index_t const *index = call->handle->index;
+
+    index_image_t const *record = call->image;
+    size_t cursor = index->entries[record->entry].offset;
+
+    wad_t wad;
+    memset(&wad, 0x00, sizeof (wad_t));
+
+    if (read_wad_information(archive, &wad, &cursor) == NME_FALSE ||
+        record->palette_id >= wad.number_of_palettes) {
+        escape(NME_ERROR_CORRUPT);
+    }
+
+    wad.colors = expand_palettes(&call->arena,
+        wad.palettes + record->palette_id, 1);
+
+    image_t image;
+    memset(&image, 0x00, sizeof (image_t));
+
+    image.width = record->width;
+    image.height = record->height;
+
+    image.pixel_data = view_input(archive, record->pixel_data_offset,
+        record->pixel_data_size);
+    image.pixel_data_size = record->pixel_data_size;
+
+    image.parent = &wad;
+
+    if (record->is_rle == NME_FALSE) {
+        if (has_bmp_pixel_data(&image) == NME_FALSE) {
+            escape(NME_ERROR_CORRUPT);
+        }
+
+        decode_bmp_image(call->pixels, &image, 4);
+    } else if (has_rle_dimensions(&image) == NME_FALSE ||
+        decode_rle_image(call->pixels, &image) == NME_FALSE) {
+        escape(NME_ERROR_CORRUPT);
+    }
+}
+
+nme_status_t nme_open(char const *filename, nme_archive_t **archive)
+{
+    if (filename == NULL || archive == NULL) {
+        return NME_ERROR_INVALID_ARGUMENT;
+    }
+
+    library_call_t call;
+
+    memset(&call, 0x00, sizeof (library_call_t));
+    call.filename = filename;
+
+    return open_archive(&call, archive);
+}
+
+nme_status_t nme_open_memory(void const *data, size_t size,
+    nme_archive_t **archive)
+{
+    if (data == NULL || size == 0 || archive == NULL) {
+        return NME_ERROR_INVALID_ARGUMENT;
+    }
+
+    library_call_t call;
+
+    memset(&call, 0x00, sizeof (library_call_t));
+
+    call.data = data;
+    call.size = size;
+
+    return open_archive(&call, archive);
+}
+
+void nme_close(nme_archive_t *archive)
+{
+    if (archive == NULL) {
+        return;
+    }
+
+    free_index(archive->index);
+
+    if (archive->is_mapped == NME_TRUE) {
+        unmap_file(archive->archive.data, archive->archive.size);
+    }
+
+    release(archive);
+}
+
+nme_status_t nme_for_each_entry(nme_archive_t const *archive,
+    nme_entry_callback_t callback, void *context)
+{
+    if (archive == NULL || callback == NULL) {
+        return NME_ERROR_INVALID_ARGUMENT;
+    }
+
+    index_header_t const *header = archive->index->header;
+
+    for (uint32_t i = 0; i < header->number_of_entries +
+        header->number_of_images; ++i) {
+        nme_entry_t entry;
+        describe_entry(archive, i + 1, &entry);
+
+        if (callback(&entry, context) != 0) {
+            break;
+        }
+    }
+
+    return NME_OK;
+}
+
+nme_status_t nme_find_entry(nme_archive_t const *archive, char const *path,
+    nme_entry_t *entry)
+{
+    if (archive == NULL || path == NULL || entry == NULL) {
+        return NME_ERROR_INVALID_ARGUMENT;
+    }
+
+    uint32_t value = find_in_archive(archive, path);
+
+    if (value == 0) {
+        return NME_ERROR_NOT_FOUND;
+    }
+
+    describe_entry(archive, value, entry);
+    return NME_OK;
+}
+
+nme_status_t nme_read_entry(nme_archive_t const *archive, char const *path,
+    void *buffer, size_t capacity, size_t *size)
+{
+    if (archive == NULL || path == NULL || size == NULL) {
+        return NME_ERROR_INVALID_ARGUMENT;
+    }
+
+    uint32_t value = find_in_archive(archive, path);
+
+    if (value == 0) {
+        return NME_ERROR_NOT_FOUND;
+    }
+
+    if (value > archive->index->header->number_of_entries ||
+        archive->index->entries[value - 1].type != NME_FILE) {
+        return NME_ERROR_WRONG_TYPE;
+    }
+
+    index_entry_t const *record = &archive->index->entries[value - 1];
+    archive_t const *input = &archive->archive;
+
+    *size = record->size;
+
+    if (record->offset > input->size ||
+        record->size > input->size - record->offset) {
+        return NME_ERROR_CORRUPT;
+    }
+
+    if (capacity < record->size) {
+        return NME_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    if (record->size == 0) {
+        return NME_OK;
+    }
+
+    if (buffer == NULL) {
+        return NME_ERROR_INVALID_ARGUMENT;
+    }
+
+    memcpy(buffer, input->data + record->offset, record->size);
+    return NME_OK;
+}
+
+nme_status_t nme_decode_image(nme_archive_t const *archive, char const *path,
+    uint8_t *pixels, size_t capacity, uint32_t *width, uint32_t *height)
+{
+    if (archive == NULL || path == NULL || width == NULL || height == NULL) {
+        return NME_ERROR_INVALID_ARGUMENT;
+    }
+
+    uint32_t const number_of_entries =
+        archive->index->header->number_of_entries;
+    uint32_t value = find_in_archive(archive, path);
+
+    if (value == 0) {
+        return NME_ERROR_NOT_FOUND;
+    }
+
+    if (value <= number_of_entries) {
+        return NME_ERROR_WRONG_TYPE;
+    }
+
+    index_image_t const *record =
+        &archive->index->images[value - number_of_entries - 1];
+
+    *width = record->width;
+    *height = record->height;
+
+    if (record->width != 0 && record->height > SIZE_MAX / 4 / record->width) {
+        return NME_ERROR_CORRUPT;
+    }
+
+    if (capacity < (size_t) record->width * record->height * 4) {
+        return NME_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    if (record->width == 0 || record->height == 0) {
+        return NME_OK;
+    }
+
+    if (pixels == NULL) {
+        return NME_ERROR_INVALID_ARGUMENT;
+    }
+
+    library_call_t call;
+    memset(&call, 0x00, sizeof (library_call_t));
+
+    call.handle = (nme_archive_t *) archive;
+    call.image = record;
+    call.pixels = pixels;
+
+    nme_status_t status = run_protected(decode_archive_image, &call);
+    free_arena(&call.arena);
+
+    return status;
+}
+
+char const *nme_describe_status(nme_status_t status)
+{
+    switch (status) {
+    case NME_OK:
+        return "success";
+    case NME_ERROR_INVALID_ARGUMENT:
+        return "invalid argument";
+    case NME_ERROR_OPEN:
+        return "unable to open archive";
+    case NME_ERROR_CORRUPT:
+        return "invalid or corrupt archive";
+    case NME_ERROR_OUT_OF_MEMORY:
+        return "out of memory";
+    case NME_ERROR_NOT_FOUND:
+        return "no such entry";
+    case NME_ERROR_WRONG_TYPE:
+        return "wrong entry type";
+    case NME_ERROR_BUFFER_TOO_SMALL:
+        return "buffer too small";
+    }
+
+    return "unknown error";
+}
+
+#if defined (NME_POSIX)
+static size_t hash_cached_image(size_t archive, uint32_t value,
+    encoder_t const *encoder)
+{
+    uint64_t hash = (uint64_t) archive * NME_HASH_PRIMES[0] ^
+        (uint64_t) value * NME_HASH_PRIMES[1] ^
+        (uint64_t) (uintptr_t) encoder * NME_HASH_PRIMES[2];
+
+    return (size_t) (hash ^ hash >> 29);
+}
+
+static void create_image_cache(image_cache_t *cache, size_t limit)
+{
+    memset(cache, 0x00, sizeof (image_cache_t));
+
+    cache->limit = limit;
+    cache->capacity = NME_STRING_SET_CAPACITY;
+
+    while (cache->capacity < limit / NME_CACHED_IMAGE_SIZE &&
+        cache->capacity < NME_MAXIMUM_CACHE_SLOTS) {
+        cache->capacity <<= 1;
+    }
+
+    cache->slots = allocate(sizeof (cached_image_t *) * cache->capacity);
+    create_mutex(&cache->mutex);
+}
+
+static void detach_cached_image(image_cache_t *cache, cached_image_t *image)
+{
+    cached_image_t **slot = &cache->slots[hash_cached_image(image->archive,
+        image->value, image->encoder) & (cache->capacity - 1)];
+
+    while (*slot != image) {
+        slot = &(*slot)->next;
+    }
+
+    *slot = image->next;
+
+    if (image->newer != NULL) {
+        image->newer->older = image->older;
+    } else {
+        cache->newest = image->older;
+    }
+
+    if (image->older != NULL) {
+        image->older->newer = image->newer;
+    } else {
+        cache->oldest = image->newer;
+    }
+
+    image->next = image->newer = image->older = NULL;
+    image->is_cached = NME_FALSE;
 
-    return NME_FALSE;
+    cache->size -= image->size;
+    --cache->count;
 }
 
-static char *get_path_for_entry(entry_t const *entry)
+static void attach_cached_image(image_cache_t *cache, cached_image_t *image)
 {
-    char *path = allocate(4096);
+    cached_image_t **slot = &cache->slots[hash_cached_image(image->archive,
+        image->value, image->encoder) & (cache->capacity - 1)];
 
-    if (NME_OUTPUT_PATH == NULL || entry == NULL) {
-        return path;
-    }
+    image->next = *slot;
+    *slot = image;
 
-    strcpy(path, entry->name);
-    prepend(path, &NME_PATH_SEPARATOR, 1);
+    image->newer = NULL;
+    image->older = cache->newest;
 
-    for (entry = entry->parent; entry != NULL; entry = entry->parent) {
-        prepend(path, entry->name, strlen(entry->name));
-        prepend(path, &NME_PATH_SEPARATOR, 1);
+    if (cache->newest != NULL) {
+        cache->newest->newer = image;
+    } else {
+        cache->oldest = image;
     }
 
-    return prepend(path, NME_OUTPUT_PATH, strlen(NME_OUTPUT_PATH));
-}
+    cache->newest = image;
+    image->is_cached = NME_TRUE;
 
-static char *get_path_for_wad(wad_t const *wad)
-{
-    NME_ASSERT(wad != NULL);
-    return get_path_for_entry(wad->entry);
+    cache->size += image->size;
+    ++cache->count;
 }
 
-static char *get_path_for_image(image_t const *image)
+static cached_image_t *find_cached_image(image_cache_t *cache, size_t archive,
+    uint32_t value, encoder_t const *encoder)
 {
-    NME_ASSERT(image != NULL);
+    cached_image_t *image = cache->slots[hash_cached_image(archive, value,
+        encoder) & (cache->capacity - 1)];
 
-    char *path = get_path_for_wad(image->parent);
-    strncat(path, &NME_PATH_SEPARATOR, 1);
+    while (image != NULL && (image->archive != archive ||
+        image->value != value || image->encoder != encoder)) {
+        image = image->next;
+    }
 
-    return strcat(path, image->name);
+    return image;
 }
 
-static void create_directory_for_file(char *path)
+static cached_image_t *acquire_cached_image(image_cache_t *cache,
+    size_t archive, uint32_t value, encoder_t const *encoder)
 {
-    char *command = allocate(4096);
-    char *last_path_separator = strrchr(path, '\\');
-
-    if (last_path_separator == NULL) {
-        last_path_separator = strrchr(path, '/');
-    }
+    lock_mutex(&cache->mutex);
 
-    if (last_path_separator != NULL) {
-        *last_path_separator = '\0';
-    }
+    cached_image_t *image = find_cached_image(cache, archive, value, encoder);
 
-    snprintf(command, 4096, "mkdir \"%s\" > nul 2>&1", path);
+    if (image != NULL) {
+        detach_cached_image(cache, image);
+        attach_cached_image(cache, image);
 
-    if (last_path_separator != NULL) {
-        *last_path_separator = NME_PATH_SEPARATOR;
+        ++image->references;
+        ++cache->hits;
+    } else {
+        ++cache->misses;
     }
 
-    system(command);
-    release(command);
+    unlock_mutex(&cache->mutex);
+    return image;
 }
 
-static void check_file_health(FILE *file)
+static void release_cached_image(image_cache_t *cache, cached_image_t *image)
 {
-    NME_ASSERT(file != NULL);
+    lock_mutex(&cache->mutex);
 
-    if (file == NULL || ferror(file) != 0) {
-        die("invalid or corrupt file");
-    } else if (feof(file) == NME_TRUE) {
-        die("premature end of file");
+    int is_unused = (--image->references == 0 &&
+        image->is_cached == NME_FALSE);
+
+    unlock_mutex(&cache->mutex);
+
+    if (is_unused == NME_TRUE) {
+        release(image);
     }
 }
 
-static void *read_from_file(void *destination, size_t size)
+static cached_image_t *insert_cached_image(image_cache_t *cache,
+    cached_image_t *image)
 {
-    if (destination == NULL) {
-        die("invalid or corrupt destination buffer");
+    if (image->size > cache->limit) {
+        return image;
     }
 
-    check_file_health(NME_INPUT_FILE);
-    size_t count = fread(destination, size, 1, NME_INPUT_FILE);
+    lock_mutex(&cache->mutex);
 
-    if (count != 1) {
-        report("read_from_file(%lu) failed", size);
-    }
+    cached_image_t *existing = find_cached_image(cache, image->archive,
+        image->value, image->encoder);
 
-    return destination;
-}
+    if (existing != NULL) {
+        ++existing->references;
+        unlock_mutex(&cache->mutex);
 
-static void write_into_file(void const *source, size_t size)
-{
-    if (source == NULL) {
-        die("invalid or corrupt source buffer");
+        release(image);
+        return existing;
     }
 
-    check_file_health(NME_OUTPUT_FILE);
-    size_t count = fwrite(source, size, 1, NME_OUTPUT_FILE);
+    while (cache->size + image->size > cache->limit) {
+        cached_image_t *victim = cache->oldest;
+        detach_cached_image(cache, victim);
 
-    if (count != 1) {
-        report("write_into_file(0x%08x, %lu) failed", source, size);
+        if (victim->references == 0) {
+            release(victim);
+        }
     }
+
+    attach_cached_image(cache, image);
+    unlock_mutex(&cache->mutex);
+
+    return image;
 }
 
-static void dump_to_file(char const *filename, void const *contents,
-    size_t size)
+static int send_response(int descriptor, char const *message, ...)
 {
-    NME_ASSERT(filename != NULL);
+    char header[256];
 
-    NME_OUTPUT_FILE = fopen(filename, "wb");
-
-    check_file_health(NME_OUTPUT_FILE);
-    write_into_file(contents, size);
+    va_list arguments;
+    va_start(arguments, message);
 
-    fclose(NME_OUTPUT_FILE);
-}
+    int length = vsnprintf(header, sizeof (header), message, arguments);
 
-static void extract_file_subsection(char const *filename, size_t size)
-{
-    uint8_t *buffer = allocate(size);
+    va_end(arguments);
 
-    read_from_file(buffer, size);
-    dump_to_file(filename, buffer, size);
+    if (length < 0 || (size_t) length >= sizeof (header)) {
+        length = snprintf(header, sizeof (header), "error response too long\n");
+    }
 
-    release(buffer);
+    return write_in_chunks(descriptor, (uint8_t const *) header,
+        (size_t) length);
 }
 
-static void free_image(image_t *image)
+static cached_image_t *render_image(connection_t *connection,
+    size_t archive, char const *path, encoder_t const *encoder,
+    nme_status_t *status)
 {
-    release(image->line_offsets.values);
-    release(image->pixel_data);
+    nme_archive_t const *handle = connection->server->archives[archive];
 
-    release(image);
-}
+    uint32_t width = 0;
+    uint32_t height = 0;
 
-static image_t *read_image_information(image_t *image)
-{
-    NME_ASSERT(image != NULL);
+    *status = nme_decode_image(handle, path, NULL, 0, &width, &height);
 
-    size_t const non_header_data_size = sizeof (uint8_t *) +
-        sizeof (uint32_t) + sizeof (line_offsets_t) + sizeof (wad_t const *);
+    if (*status == NME_OK) {
+        *status = NME_ERROR_CORRUPT;
+    }
 
-    read_from_file(image, sizeof (image_t) - non_header_data_size);
-    image->name[31] = '\0';
+    if (*status != NME_ERROR_BUFFER_TOO_SMALL) {
+        return NULL;
+    }
 
-    fseek(NME_INPUT_FILE, 6, SEEK_CUR);
+    size_t const size = (size_t) width * height * 4;
 
-    return image;
-}
+    connection->pixels.size = 0;
+    reserve_buffer(&connection->pixels, size);
 
-static image_t *read_image_pixel_data(image_t *image)
-{
-    NME_ASSERT(image != NULL);
+    *status = nme_decode_image(handle, path, connection->pixels.data, size,
+        &width, &height);
 
-    image->pixel_data = allocate(image->pixel_data_size);
-    read_from_file(image->pixel_data, image->pixel_data_size);
+    if (*status != NME_OK) {
+        return NULL;
+    }
 
-    return image;
-}
+    connection->encoded.size = 0;
 
-static image_t *read_image_line_offsets(image_t *image)
-{
-    NME_ASSERT(image != NULL);
+    if (encoder->encode(&connection->encoded, &connection->scanlines,
+        connection->pixels.data, width, height, 4) == NME_FALSE) {
+        *status = NME_ERROR_CORRUPT;
+        return NULL;
+    }
 
-    size_t const non_header_data_size = sizeof (uint32_t *);
+    cached_image_t *image = allocate_uninitialized(sizeof (cached_image_t) +
+        connection->encoded.size);
 
-    read_from_file(&image->line_offsets, sizeof (line_offsets_t) -
-        non_header_data_size);
+    memset(image, 0x00, sizeof (cached_image_t));
+    memcpy(image->data, connection->encoded.data, connection->encoded.size);
 
-    if (image->height == 0) {
-        return image;
-    }
+    image->archive = archive;
+    image->value = find_in_archive(handle, path);
+    image->encoder = encoder;
 
-    image->line_offsets.values = allocate(sizeof (uint32_t) * image->height);
+    image->references = 1;
 
-    read_from_file(image->line_offsets.values, sizeof (uint32_t) *
-        image->height);
+    image->width = width;
+    image->height = height;
+    image->size = connection->encoded.size;
 
-    return image;
+    return insert_cached_image(&connection->server->cache, image);
 }
 
-static void extract_bmp_image(image_t const *image)
+static int send_statistics(connection_t *connection)
 {
-    NME_ASSERT(image != NULL && image->parent != NULL);
-
-    wad_t const *parent = image->parent;
+    image_cache_t *cache = &connection->server->cache;
+    char text[256];
 
-    NME_ASSERT(parent->palettes != NULL);
-    NME_ASSERT(image->palette_id < parent->number_of_palettes);
+    lock_mutex(&cache->mutex);
 
-    uint8_t *pixel_data = allocate(image->width * image->height * 3);
+    int length = snprintf(text, sizeof (text), "archives %zu\n"
+        "cached images %zu\ncached bytes %zu\ncache limit %zu\nhits %zu\n"
+        "misses %zu\n", connection->server->number_of_archives, cache->count,
+        cache->size, cache->limit, cache->hits, cache->misses);
 
-    for (uint32_t y = 0; y < image->height; ++y) {
-        for (uint32_t x = 0; x < image->width; ++x) {
-            size_t from = x + y * (image->width + 2);
-            size_t to = 3 * (x + y * image->width);
+    unlock_mutex(&cache->mutex);
 
-            uint8_t palette_entry = image->pixel_data[from];
+    return send_response(connection->descriptor, "ok %d\n", length) ==
+        NME_TRUE && write_in_chunks(connection->descriptor,
+        (uint8_t const *) text, (size_t) length) == NME_TRUE;
+}
 
-            palette_t const *palette = &parent->palettes[image->palette_id];
-            uint16_t color = palette->colors[palette_entry];
+static int send_file(connection_t *connection, nme_archive_t const *handle,
+    uint32_t value)
+{
+    int const descriptor = connection->descriptor;
 
-            pixel_data[to + 0] = get_red(color);
-            pixel_data[to + 1] = get_green(color);
-            pixel_data[to + 2] = get_blue(color);
-        }
+    if (value > handle->index->header->number_of_entries ||
+        handle->index->entries[value - 1].type != NME_FILE) {
+        return send_response(descriptor, "error %s\n",
+            nme_describe_status(NME_ERROR_WRONG_TYPE));
     }
 
-    char *path = get_path_for_image(image);
-    create_directory_for_file(path);
+    index_entry_t const *record = &handle->index->entries[value - 1];
+    archive_t const *input = &handle->archive;
 
-    stbi_write_bmp(path, image->width, image->height, 3, pixel_data);
+    if (record->offset > input->size ||
+        record->size > input->size - record->offset) {
+        return send_response(descriptor, "error %s\n",
+            nme_describe_status(NME_ERROR_CORRUPT));
+    }
 
-    release(path);
-    release(pixel_data);
+    return send_response(descriptor, "ok %zu\n",
+        (size_t) record->size) ==
+        NME_TRUE && write_in_chunks(descriptor, input->data + record->offset,
+        record->size) == NME_TRUE;
 }
 
-static void extract_rle_image(image_t const *image)
+static int serve_request(connection_t *connection, char *line)
 {
-    NME_ASSERT(image != NULL && image->parent != NULL);
-    NME_ASSERT(image->pixel_data != NULL);
+    server_t const *server = connection->server;
+    int const descriptor = connection->descriptor;
 
-    wad_t const *parent = image->parent;
+    char *command = line;
+    char *filename = strchr(command, ' ');
 
-    NME_ASSERT(parent->palettes != NULL);
-    NME_ASSERT(image->palette_id < parent->number_of_palettes);
+    if (strcmp(command, "stats") == 0) {
+        return send_statistics(connection);
+    }
 
-    uint8_t *pixel_data = allocate(image->width * image->height << 2);
-    size_t tracker = 0;
+    char *path = (filename != NULL) ? strchr(filename + 1, ' ') : NULL;
 
-    for (size_t index = 0; index < image->pixel_data_size; ++index) {
-        uint8_t count = image->pixel_data[index];
+    if (path == NULL) {
+        return send_response(descriptor, "error malformed request\n");
+    }
 
-        if (count == 0xFF) {
-            count = image->pixel_data[++index];
+    *(filename++) = '\0';
+    *(path++) = '\0';
 
-            for (; count > 0; --count) {
-                pixel_data[(tracker << 2) + 0] = 255;
-                pixel_data[(tracker << 2) + 1] = 0;
-                pixel_data[(tracker << 2) + 2] = 255;
-                pixel_data[(tracker << 2) + 3] = 0;
+    encoder_t const *encoder = find_encoder(command);
 
-                ++tracker;
-            }
-        } else {
-            uint8_t alpha = 255;
+    if (encoder == NULL && strcmp(command, "file") != 0) {
+        return send_response(descriptor, "error unknown command\n");
+    }
 
-            if (count == 0xFE) {
-                count = image->pixel_data[++index];
-                alpha = 127;
-            }
+    size_t archive = 0;
 
-            for (; count > 0; --count) {
-                uint8_t palette_entry = image->pixel_data[++index];
+    while (archive < server->number_of_archives &&
+        strcmp(server->filenames[archive], filename) != 0) {
+        ++archive;
+    }
 
-                palette_t const *palette =
-                    &parent->palettes[image->palette_id];
+    if (archive == server->number_of_archives) {
+        return send_response(descriptor, "error unknown archive\n");
+    }
 
-                uint16_t color = palette->colors[palette_entry];
+    nme_archive_t const *handle = server->archives[archive];
+    uint32_t value = find_in_archive(handle, path);
 
-                pixel_data[(tracker << 2) + 0] = get_red(color);
-                pixel_data[(tracker << 2) + 1] = get_green(color);
-                pixel_data[(tracker << 2) + 2] = get_blue(color);
-                pixel_data[(tracker << 2) + 3] = alpha;
+    if (value == 0) {
+        return send_response(descriptor, "error %s\n",
+            nme_describe_status(NME_ERROR_NOT_FOUND));
+    }
 
-                ++tracker;
-            }
-        }
+    if (encoder == NULL) {
+        return send_file(connection, handle, value);
     }
 
-    char *path = get_path_for_image(image);
-    create_directory_for_file(path);
+    nme_status_t status = NME_OK;
+    cached_image_t *image = acquire_cached_image(&connection->server->cache,
+        archive, value, encoder);
 
-    char *extension = strrchr(path, '.');
+    if (image == NULL) {
+        image = render_image(connection, archive, path, encoder, &status);
+    }
 
-    if (extension != NULL) {
-        *extension = '\0';
-        strcat(path, ".png");
+    if (image == NULL) {
+        return send_response(descriptor, "error %s\n",
+            nme_describe_status(status));
     }
 
-    stbi_write_png(path, image->width, image->height, 4, pixel_data, 0);
+    int is_sent = (send_response(descriptor, "ok %zu %u %u\n",
+        image->size, image->width, image->height) == NME_TRUE &&
+        write_in_chunks(descriptor, image->data, image->size) == NME_TRUE);
 
-    release(path);
-    release(pixel_data);
+    release_cached_image(&connection->server->cache, image);
+    return is_sent;
 }
 
-static void print_image_information(image_t const *image)
+static void serve_next_request(void *context)
 {
-    NME_ASSERT(image != NULL);
-
-    if (NME_VERBOSITY == NME_SILENT) {
-        return;
-    }
-
-    printf("{$ %s # %llu w %u h %u @ %u ~ %u} ", image->name,
-        image->pixel_data_size, image->width, image->height,
-        image->color_depth, image->palette_id);
+    connection_t *connection = context;
+    connection->is_open = serve_request(connection, connection->request);
 }
 
-static void process_wad_archive(wad_t *wad)
+static void *run_connection(void *context)
 {
-    NME_ASSERT(wad != NULL);
-
-    check_file_health(NME_INPUT_FILE);
-    fseek(NME_INPUT_FILE, 400, SEEK_CUR);
-
-    read_from_file(&wad->number_of_palettes, sizeof (uint32_t));
-
-    if (wad->number_of_palettes == 0) {
-        release(wad->palettes);
-        return;
-    }
+    connection_t *connection = context;
+    FILE *input = fdopen(connection->descriptor, "r");
 
-    wad->palettes = allocate(wad->number_of_palettes * sizeof (palette_t));
-    read_from_file(wad->palettes,
-        wad->number_of_palettes * sizeof (palette_t));
-
-    read_from_file(&wad->number_of_images, sizeof (uint32_t));
-
-    if (wad->number_of_images == 0) {
-        release(wad->palettes);
-        return;
-    }
-
-    for (uint32_t i = 0; i < wad->number_of_images; ++i) {
-        image_t *image = allocate(sizeof (image_t));
+    size_t const capacity = NME_MAXIMUM_REQUEST_LENGTH + 2;
+    char *line = allocate(capacity);
 
-        image->parent = wad;
+    while (input != NULL && fgets(line, (int) capacity, input) != NULL) {
+        size_t length = strlen(line);
 
-        read_image_information(image);
-        read_image_pixel_data(image);
+        if (length == capacity - 1 && line[length - 1] != '\n') {
+            send_response(connection->descriptor, "error request too long\n");
+            break;
+        }
 
-        int is_rle = has_extension(image->name, "rle");
+        while (length > 0 && (line[length - 1] == '\n' ||
+            line[length - 1] == '\r')) {
+            line[--length] = '\0';
+        }
 
-        if (is_rle == NME_TRUE) {
-            read_image_line_offsets(image);
+        if (length == 0) {
+            continue;
         }
 
-        read_from_file(&image->palette_id, sizeof (uint32_t));
+        connection->request = line;
+        nme_status_t status = run_protected(serve_next_request, connection);
 
-        if (NME_VERBOSITY != NME_SILENT) {
-            print_image_information(image);
+        if (status != NME_OK) {
+            connection->is_open = send_response(connection->descriptor,
+                "error %s\n", nme_describe_status(status));
         }
 
-        if (is_rle == NME_TRUE) {
-            extract_rle_image(image);
-        } else {
-            extract_bmp_image(image);
+        if (connection->is_open == NME_FALSE) {
+            break;
         }
-
-        free_image(image);
     }
 
-    release(wad->palettes);
-}
-
-static entry_t *read_entry_information(entry_t *entry)
-{
-    NME_ASSERT(entry != NULL);
+    release(line);
 
-    size_t const non_header_data_size = sizeof (entry_t const *);
+    if (input != NULL) {
+        fclose(input);
+    } else {
+        close(connection->descriptor);
+    }
 
-    check_file_health(NME_INPUT_FILE);
-    read_from_file(entry, sizeof (entry_t) - non_header_data_size);
+    free_buffer(&connection->pixels);
+    free_buffer(&connection->scanlines);
+    free_buffer(&connection->encoded);
 
-    entry->name[31] = '\0';
-    return entry;
+    release(connection);
+    return NULL;
 }
 
-static void extract_entry_contents(entry_t const *entry)
+static int open_server_socket(char const *filename)
 {
-    NME_ASSERT(entry != NULL && entry->type == NME_FILE);
+    struct sockaddr_un address;
+    memset(&address, 0x00, sizeof (struct sockaddr_un));
 
-    if (NME_OUTPUT_PATH == NULL || entry->size == 0) {
-        return;
+    if (strlen(filename) >= sizeof (address.sun_path)) {
+        fail("socket path `%s` is too long", filename);
     }
 
-    if (has_extension(entry->name, "wad") == NME_TRUE) {
-        wad_t *wad = allocate(sizeof (wad_t));
-        wad->entry = entry;
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, filename);
 
-        process_wad_archive(wad);
-        release(wad);
-    } else {
-        char *path = get_path_for_entry(entry);
-        create_directory_for_file(path);
+    struct stat information;
 
-        extract_file_subsection(path, entry->size);
-        release(path);
+    if (lstat(filename, &information) == 0 &&
+        S_ISSOCK(information.st_mode)) {
+        unlink(filename);
     }
-}
 
-static void print_entry_information(entry_t const *entry)
-{
-    NME_ASSERT(entry != NULL);
+    int descriptor = socket(AF_UNIX, SOCK_STREAM, 0);
 
-    if (NME_VERBOSITY == NME_SILENT || entry->type == NME_END_OF_DIRECTORY) {
-        return;
+    if (descriptor < 0 || bind(descriptor, (struct sockaddr *) &address,
+        sizeof (struct sockaddr_un)) != 0 ||
+        listen(descriptor, SOMAXCONN) != 0) {
+        die("unable to listen on `%s`", filename);
     }
 
-    printf("[%s %u %u] ", entry->name, entry->offset, entry->size);
+    return descriptor;
 }
 
-static void enqueue_entry_hierarchy(queue_t *queue, entry_t const *parent)
+static int serve_archives(char const *filename)
 {
-    NME_ASSERT(queue != NULL);
+    server_t server;
+    memset(&server, 0x00, sizeof (server_t));
 
-    entry_t *entry = allocate(sizeof (entry_t));
-    entry->parent = parent;
+    server.filenames = (char const **) NME_INPUT_FILENAMES.data;
+    server.number_of_archives = NME_INPUT_FILENAMES.size /
+        sizeof (char const *);
 
-    read_entry_information(entry);
+    server.archives = allocate(sizeof (nme_archive_t *) *
+        server.number_of_archives);
 
-    while (entry->type != NME_END_OF_DIRECTORY) {
-        enqueue(queue, entry);
-        read_entry_information(entry);
-    }
+    for (size_t i = 0; i < server.number_of_archives; ++i) {
+        nme_status_t status = nme_open(server.filenames[i],
+            &server.archives[i]);
 
-    release(entry);
-}
+        if (status != NME_OK) {
+            fail("unable to serve `%s`: %s", server.filenames[i],
+                nme_describe_status(status));
+        }
+    }
 
-static int process_dir_archive(void)
-{
-    NME_INPUT_FILE = fopen(NME_INPUT_FILENAME, "rb");
-    check_file_health(NME_INPUT_FILE);
+    create_encoder_tables();
+    create_image_cache(&server.cache, NME_CACHE_LIMIT);
 
-    queue_t *queue = create_queue(NME_QUEUE_CAPACITY);
-    enqueue_entry_hierarchy(queue, NULL);
+    signal(SIGPIPE, SIG_IGN);
 
-    while (is_queue_empty(queue) == NME_FALSE) {
-        entry_t const *entry = dequeue(queue);
-        NME_ASSERT(entry != NULL);
+    int listener = open_server_socket(filename);
 
-        fseek(NME_INPUT_FILE, entry->offset, SEEK_SET);
+    if (NME_VERBOSITY != NME_SILENT) {
+        printf("serving %zu archive(s) on `%s`\n", server.number_of_archives,
+            filename);
+        fflush(stdout);
+    }
 
-        switch (entry->type) {
-        case NME_FILE:
-            extract_entry_contents(entry);
-            break;
+    for (;;) {
+        int descriptor = accept(listener, NULL, NULL);
 
-        case NME_DIRECTORY:
-            enqueue_entry_hierarchy(queue, entry);
-            break;
+        if (descriptor < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
 
-        default:
-            die("corrupt entry");
             break;
         }
 
-        if (NME_VERBOSITY != NME_SILENT) {
-            print_entry_information(entry);
-        }
-    }
-
-    free_queue(queue);
+        connection_t *connection = allocate(sizeof (connection_t));
 
-    fclose(NME_INPUT_FILE);
+        connection->server = &server;
+        connection->descriptor = descriptor;
 
-    if (NME_VERBOSITY != NME_SILENT) {
-        report("used %u bytes of heap memory", NME_MAXIMUM_HEAP_USAGE);
+        pthread_t thread;
 
-        if (NME_CURRENT_HEAP_USAGE != 0) {
-            die("leaked %u bytes of heap memory", NME_CURRENT_HEAP_USAGE);
+        if (pthread_create(&thread, NULL, run_connection, connection) == 0) {
+            pthread_detach(thread);
+        } else {
+            run_connection(connection);
         }
     }
 
-    return EXIT_SUCCESS;
+    die("unable to accept connections on `%s`", filename);
+    return EXIT_FAILURE;
+}
+#else
+static int serve_archives(char const *filename)
+{
+    (void) filename;
+
+    fail("option `--serve` is not supported on this platform");
+    return EXIT_FAILURE;
 }
+#endif
 
 static char const *get_executable_name(char *executable_path)
 {
@@ -812,8 +8292,46 @@ static void display_help_screen(void)
         "Options:\n"
         "        -e [path=`.`] extract files\n"
         "        -h            display this help screen\n"
+        "        -j [n=all]    extract using `n` worker threads\n"
         "        -v            display version information\n"
         "        -z            print entry information\n"
+        "\n"
+        "        --build-index write a lookup index next to the archive\n"
+        "        --index path  read or write the index at `path`\n"
+        "        --find path   print the entry or image at `path`, or extract "
+        "it with -e\n"
+        "        --only glob   only extract entries and images matching "
+        "`glob`\n"
+        "        --openat      write files relative to cached directory "
+        "handles\n"
+        "        --incremental skip entries unchanged since the last "
+        "extraction\n"
+        "        --memory-limit n\n"
+        "                      bound in-flight image memory to `n` bytes "
+        "(k, m, g)\n"
+        "        --format fmt  write images as bmp, png, ppm, qoi or rgba\n"
+        "        --atlas       pack the images of each wad into pages "
+        "(`--atlas=size`)\n"
+        "        --png-level n compress png images at level `n` (0-9)\n"
+        "        --indexed     write bmp and png images with 8-bit palettes\n"
+        "        --output-tar file\n"
+        "                      stream all outputs as one tar to `file` or "
+        "`-`\n"
+        "        --async-io    write outputs in the background "
+        "(`--async-io=threads`)\n"
+        "        --dedup       hard link duplicate outputs "
+        "(`--dedup=clone`)\n"
+        "        --stats       print per-stage statistics as json "
+        "(`--stats=file`)\n"
+        "        --pack path   write the input archive from the tree at "
+        "`path`\n"
+        "        --align n     align packed entry data to `n` bytes (k, m, g)\n"
+        "        --serve socket\n"
+        "                      serve entries and images over a unix "
+        "`socket`\n"
+        "        --cache-size n\n"
+        "                      cache `n` bytes of served images "
+        "(default 64m)\n"
         "\n",
         NME_EXECUTABLE_NAME);
 }
@@ -840,6 +8358,25 @@ static void handle_command_line_option(char option, char const *argument)
         display_help_screen();
         break;
 
+    case 'j':
+        NME_NUMBER_OF_WORKERS = 0;
+
+        if (argument != NULL) {
+            NME_NUMBER_OF_WORKERS = strtoul(argument, NULL, 10);
+        }
+
+        if (NME_NUMBER_OF_WORKERS == 0) {
+            NME_NUMBER_OF_WORKERS = get_number_of_processors();
+        }
+
+#if !defined (NME_THREADS)
+        if (NME_NUMBER_OF_WORKERS > 1) {
+            report("threads are not supported on this platform");
+            NME_NUMBER_OF_WORKERS = 1;
+        }
+#endif
+        break;
+
     case 'v':
         display_version_information();
         break;
@@ -853,6 +8390,163 @@ static void handle_command_line_option(char option, char const *argument)
     }
 }
 
+static size_t parse_size(char const *argument)
+{
+    NME_ASSERT(argument != NULL);
+
+    char *end = NULL;
+    unsigned long long value = strtoull(argument, &end, 10);
+
+    if (end == argument || *argument == '-') {
+        return 0;
+    }
+
+    unsigned shift = 0;
+
+    switch (tolower((unsigned char) *end)) {
+    case 'k':
+        shift = 10;
+        break;
+    case 'm':
+        shift = 20;
+        break;
+    case 'g':
+        shift = 30;
+        break;
+    case '\0':
+        break;
+    default:
+        return 0;
+    }
+
+    if (shift != 0 && end[1] != '\0') {
+        return 0;
+    }
+
+    if (value > (SIZE_MAX >> shift)) {
+        return 0;
+    }
+
+    return (size_t) value << shift;
+}
+
+static int is_long_option(char const *option, size_t length,
+    char const *name)
+{
+    return (strncmp(option, name, length) == 0 && name[length] == '\0');
+}
+
+static int has_long_option_argument(char const *option, size_t length)
+{
+    static char const *const options[] = {
+        "index", "find", "only", "format", "png-level", "memory-limit",
+        "pack", "align", "output-tar", "serve", "cache-size", NULL
+    };
+
+    for (size_t i = 0; options[i] != NULL; ++i) {
+        if (is_long_option(option, length, options[i]) == NME_TRUE) {
+            return NME_TRUE;
+        }
+    }
+
+    return NME_FALSE;
+}
+
+static void handle_command_line_long_option(char const *option, size_t length,
+    char const *argument)
+{
+    if (has_long_option_argument(option, length) == NME_TRUE &&
+        argument == NULL) {
+        fail("option `--%.*s` requires an argument", (int) length, option);
+    }
+
+    if (is_long_option(option, length, "build-index") == NME_TRUE) {
+        NME_BUILD_INDEX = NME_TRUE;
+    } else if (is_long_option(option, length, "index") == NME_TRUE) {
+        NME_INDEX_FILENAME = argument;
+    } else if (is_long_option(option, length, "find") == NME_TRUE) {
+        NME_LOOKUP_PATH = argument;
+    } else if (is_long_option(option, length, "only") == NME_TRUE) {
+        append_to_buffer(&NME_SELECTION_PATTERNS, &argument,
+            sizeof (char const *));
+    } else if (is_long_option(option, length, "stats") == NME_TRUE) {
+        NME_COLLECT_STATISTICS = NME_TRUE;
+        NME_STATISTICS_FILENAME = argument;
+    } else if (is_long_option(option, length, "atlas") == NME_TRUE) {
+        NME_ATLAS_SIZE = (argument != NULL) ? parse_size(argument) :
+            NME_DEFAULT_ATLAS_SIZE;
+
+        if (NME_ATLAS_SIZE == 0 || NME_ATLAS_SIZE > NME_MAXIMUM_ATLAS_SIZE) {
+            fail("invalid atlas size `%s`", argument);
+        }
+    } else if (is_long_option(option, length, "memory-limit") == NME_TRUE) {
+        NME_MEMORY_LIMIT = parse_size(argument);
+
+        if (NME_MEMORY_LIMIT == 0) {
+            fail("invalid memory limit `%s`", argument);
+        }
+    } else if (is_long_option(option, length, "output-tar") == NME_TRUE) {
+        NME_TAR_FILENAME = argument;
+    } else if (is_long_option(option, length, "async-io") == NME_TRUE) {
+        if (argument == NULL) {
+            NME_ASYNC_IO = NME_ASYNC_IO_RING;
+        } else if (strcmp(argument, "threads") == 0) {
+            NME_ASYNC_IO = NME_ASYNC_IO_THREADS;
+        } else {
+            fail("unknown asynchronous writer `%s`", argument);
+        }
+    } else if (is_long_option(option, length, "dedup") == NME_TRUE) {
+        if (argument == NULL || strcmp(argument, "link") == 0) {
+            NME_DEDUPLICATION = NME_DEDUPLICATE_BY_LINKING;
+        } else if (strcmp(argument, "clone") == 0) {
+            NME_DEDUPLICATION = NME_DEDUPLICATE_BY_CLONING;
+        } else {
+            fail("unknown deduplication mode `%s`", argument);
+        }
+    } else if (is_long_option(option, length, "serve") == NME_TRUE) {
+        NME_SERVER_PATH = argument;
+    } else if (is_long_option(option, length, "cache-size") == NME_TRUE) {
+        NME_CACHE_LIMIT = parse_size(argument);
+
+        if (NME_CACHE_LIMIT == 0) {
+            fail("invalid cache size `%s`", argument);
+        }
+    } else if (is_long_option(option, length, "pack") == NME_TRUE) {
+        NME_PACK_PATH = argument;
+    } else if (is_long_option(option, length, "align") == NME_TRUE) {
+        NME_PACK_ALIGNMENT = parse_size(argument);
+
+        if (NME_PACK_ALIGNMENT == 0 ||
+            (NME_PACK_ALIGNMENT & (NME_PACK_ALIGNMENT - 1)) != 0) {
+            fail("invalid alignment `%s`", argument);
+        }
+    } else if (is_long_option(option, length, "indexed") == NME_TRUE) {
+        NME_INDEXED_OUTPUT = NME_TRUE;
+    } else if (is_long_option(option, length, "incremental") == NME_TRUE) {
+        NME_INCREMENTAL = NME_TRUE;
+    } else if (is_long_option(option, length, "openat") == NME_TRUE) {
+        NME_USE_OPENAT = NME_TRUE;
+    } else if (is_long_option(option, length, "format") == NME_TRUE) {
+        NME_ENCODER = find_encoder(argument);
+
+        if (NME_ENCODER == NULL) {
+            fail("unknown format `%s`", argument);
+        }
+    } else if (is_long_option(option, length, "png-level") == NME_TRUE) {
+        char *end = NULL;
+        long level = strtol(argument, &end, 10);
+
+        if (*argument == '\0' || *end != '\0' || level < 0 || level > 9) {
+            fail("invalid png compression level `%s`", argument);
+        }
+
+        NME_PNG_COMPRESSION_LEVEL = (int) level;
+        stbi_write_png_compression_level = (level > 1) ? (int) level : 8;
+    } else {
+        report("unknown option `--%.*s`", (int) length, option);
+    }
+}
+
 static void parse_command_line(int count, char **arguments)
 {
     for (int i = 1; i < count; ++i) {
@@ -861,23 +8555,42 @@ static void parse_command_line(int count, char **arguments)
 
         switch (argument[0]) {
         case '-':
-            if (argument[2] != '\0') {
+            if (argument[1] == '-') {
+                char const *option = argument + 2;
+                char const *value = strchr(option, '=');
+
+                size_t length = (value != NULL) ? (size_t) (value - option) :
+                    strlen(option);
+
+                if (value != NULL) {
+                    ++value;
+                } else if (has_long_option_argument(option, length) ==
+                    NME_TRUE && i + 1 < count) {
+                    value = arguments[++i];
+                }
+
+                handle_command_line_long_option(option, length, value);
+                break;
+            }
+
+            if (argument[1] != '\0' && argument[2] != '\0') {
                 parameters = argument + 2;
+            } else if (argument[1] == 'j' && i + 1 < count &&
+                isdigit((unsigned char) arguments[i + 1][0])) {
+                parameters = arguments[++i];
             }
 
             handle_command_line_option(argument[1], parameters);
             break;
 
         default:
-            if (NME_INPUT_FILENAME != NULL) {
-                report("overriding input filename");
-            }
-
-            NME_INPUT_FILENAME = arguments[i];
+            append_to_buffer(&NME_INPUT_FILENAMES, &arguments[i],
+                sizeof (char const *));
         }
     }
 }
 
+#if !defined (NME_NO_MAIN)
 int main(int count, char *arguments[])
 {
     NME_EXECUTABLE_NAME = get_executable_name(*arguments);
@@ -887,9 +8600,56 @@ int main(int count, char *arguments[])
 
     parse_command_line(count, arguments);
 
-    if (count == 1 || NME_INPUT_FILENAME == NULL) {
+    if (count == 1 || NME_INPUT_FILENAMES.size == 0) {
         fail("no input files");
     }
 
-    return process_dir_archive();
+    if (NME_INDEX_FILENAME != NULL &&
+        NME_INPUT_FILENAMES.size != sizeof (char const *)) {
+        fail("option `--index` requires a single input file");
+    }
+
+    if (NME_TAR_FILENAME != NULL) {
+        if (NME_INCREMENTAL == NME_TRUE || NME_DEDUPLICATION != NME_FALSE) {
+            fail("options `--incremental` and `--dedup` need a directory "
+                "output, not `--output-tar`");
+        }
+
+        if (strcmp(NME_TAR_FILENAME, "-") == 0 &&
+            (NME_VERBOSITY != NME_SILENT || (NME_COLLECT_STATISTICS ==
+            NME_TRUE && NME_STATISTICS_FILENAME == NULL))) {
+            fail("option `--output-tar -` needs standard output to itself");
+        }
+
+        if (NME_OUTPUT_PATH == NULL) {
+            NME_OUTPUT_PATH = ".";
+        }
+    }
+
+    if (NME_ASYNC_IO != NME_FALSE &&
+        (NME_DEDUPLICATION != NME_FALSE || NME_TAR_FILENAME != NULL)) {
+        fail("option `--async-io` cannot be combined with `--dedup` or "
+            "`--output-tar`");
+    }
+
+    if (NME_SERVER_PATH != NULL) {
+        return serve_archives(NME_SERVER_PATH);
+    }
+
+    if (NME_PACK_PATH != NULL) {
+        if (NME_INPUT_FILENAMES.size != sizeof (char const *)) {
+            fail("option `--pack` requires a single archive");
+        }
+
+        return pack_archive(NME_PACK_PATH,
+            *(char const **) NME_INPUT_FILENAMES.data);
+    }
+
+    if (NME_INDEXED_OUTPUT == NME_TRUE && NME_ENCODER != NULL &&
+        NME_ENCODER->encode_indexed == NULL) {
+        fail("option `--indexed` requires the bmp or png format");
+    }
+
+    return process_dir_archives();
 }
+#endif
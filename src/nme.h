@@ -0,0 +1,98 @@
+#ifndef NME_H
+#define NME_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined (__cplusplus)
+extern "C" {
+#endif
+
+/*
+ * Embeddable interface to `.dir` archives.
+ *
+ * An archive handle is immutable once opened, so entries may be read and
+ * images decoded from any number of threads at once. No function writes to
+ * disk, prints or terminates the process; every failure is returned as a
+ * status code instead.
+ */
+
+#if defined (__GNUC__)
+#define NME_API __attribute__ ((visibility ("default")))
+#else
+#define NME_API
+#endif
+
+typedef struct nme_archive nme_archive_t;
+typedef struct nme_entry nme_entry_t;
+
+typedef enum nme_status {
+    NME_OK = 0,
+    NME_ERROR_INVALID_ARGUMENT,
+    NME_ERROR_OPEN,
+    NME_ERROR_CORRUPT,
+    NME_ERROR_OUT_OF_MEMORY,
+    NME_ERROR_NOT_FOUND,
+    NME_ERROR_WRONG_TYPE,
+    NME_ERROR_BUFFER_TOO_SMALL
+} nme_status_t;
+
+typedef enum nme_entry_type {
+    NME_ENTRY_FILE,
+    NME_ENTRY_DIRECTORY,
+    NME_ENTRY_IMAGE
+} nme_entry_type_t;
+
+struct nme_entry {
+    /* `/` separated path from the archive root, owned by the archive. */
+    char const *path;
+    nme_entry_type_t type;
+
+    /* Stored bytes for files, decoded RGBA bytes for images. */
+    uint64_t size;
+
+    /* Image dimensions, zero for files and directories. */
+    uint32_t width;
+    uint32_t height;
+};
+
+/* Return non-zero to stop iterating. */
+typedef int (*nme_entry_callback_t)(nme_entry_t const *entry, void *context);
+
+NME_API nme_status_t nme_open(char const *filename, nme_archive_t **archive);
+
+/* `data` is borrowed and must outlive the archive handle. */
+NME_API nme_status_t nme_open_memory(void const *data, size_t size,
+    nme_archive_t **archive);
+
+NME_API void nme_close(nme_archive_t *archive);
+
+/* Visits directories and files breadth first, then the images of each WAD. */
+NME_API nme_status_t nme_for_each_entry(nme_archive_t const *archive,
+    nme_entry_callback_t callback, void *context);
+
+NME_API nme_status_t nme_find_entry(nme_archive_t const *archive,
+    char const *path, nme_entry_t *entry);
+
+/*
+ * Copies the stored bytes of a file into `buffer`. `size` is filled in before
+ * the capacity is checked, so a call with a NULL buffer queries it.
+ */
+NME_API nme_status_t nme_read_entry(nme_archive_t const *archive,
+    char const *path, void *buffer, size_t capacity, size_t *size);
+
+/*
+ * Decodes an image into `width * height * 4` bytes of RGBA at `pixels`.
+ * `width` and `height` are filled in before the capacity is checked.
+ */
+NME_API nme_status_t nme_decode_image(nme_archive_t const *archive,
+    char const *path, uint8_t *pixels, size_t capacity, uint32_t *width,
+    uint32_t *height);
+
+NME_API char const *nme_describe_status(nme_status_t status);
+
+#if defined (__cplusplus)
+}
+#endif
+
+#endif